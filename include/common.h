@@ -21,6 +21,10 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+/* returns true if the error code stops the whole evaluation, rather than just the expression that caused it */
+#define is_interrupt_code(code) \
+	(code == TIMEOUT || code == CANCELLED || code == STEP_LIMIT || code == MEMORY_LIMIT || code == CALL_LIMIT)
+
 /* value macros */
 #define str(x)					#x
 #define mstr(x)					str(x)
@@ -33,7 +37,10 @@
 
 /* internal "magic numbers" */
 #define SYNGE_MAX_PRECISION		64
-#define SYNGE_MAX_DEPTH			2048
+#define SYNGE_MAX_DEPTH			262144
+#define SYNGE_MAX_TAILS			262144
+#define SYNGE_HM_SIZE			42
+#define SYNGE_CHECK_INTERVAL	256 /* steps between checks for whether an evaluation has been interrupted */
 #define SYNGE_EPSILON			"1e-" mstr(SYNGE_MAX_PRECISION + 1)
 
 /* word-related things */
@@ -43,13 +50,27 @@
 #define SYNGE_FUNCTION_CHARS	"abcdefghijklmnopqrstuvwxyzABCDEFHIJKLMNOPQRSTUVWXYZ0123456789\'\"_"
 
 /* traceback format macros */
-#define SYNGE_TRACEBACK_FORMAT	"Synge Traceback (most recent call last):\n" \
-								"%s" \
-								"%s: %s"
+#define SYNGE_TRACEBACK_HEADER	"Synge Traceback (most recent call last):\n"
+#define SYNGE_TRACEBACK_ERROR	"%s: %s"
 
 #define SYNGE_TRACEBACK_MODULE		"  Module %s\n"
 #define SYNGE_TRACEBACK_CONDITIONAL	"  %s condition, at %d\n"
 #define SYNGE_TRACEBACK_FUNCTION	"  Function %s, at %d\n"
+#define SYNGE_TRACEBACK_ELIDED		"  ... %d tail calls elided\n"
+
+/* a single level of the traceback -- only turned into text when an error message is requested */
+struct synge_frame {
+	char *caller; /* borrowed from the calling stack, unless owned is set */
+	int position;
+	int kind;
+	bool owned;
+};
+
+struct synge_trace {
+	struct synge_frame *frames;
+	int length;
+	int size;
+};
 
 /* in-place macros */
 #define assert(cond, reason)	do { if(!(cond)) { fprintf(stderr, "synge: assertion '%s' (%s) failed\n", reason, #cond); abort(); }} while(0)
@@ -79,15 +100,11 @@
 /* get amount of memory needed to store a sprintf() -- including null terminator */
 #define lenprintf(...) (synge_snprintf(NULL, 0, __VA_ARGS__) + 1)
 
-/* macros for casting void stack pointers */
-#define SYNGE_T(x) (*(synge_t *) x)
-#define FUNCTION(x) ((struct synge_func *) x)
-
 struct synge_const {
 	char *name;
 	char *description;
-	/* an mpfr_* like function to set the value of the special number */
-	int (*value)();
+	/* an mpfr_* like function to set the value of the special number (also given the context) */
+	int (*value)(synge_t, mpfr_rnd_t, struct synge_ctx *);
 };
 
 /* internal stack types */
@@ -119,6 +136,7 @@ enum s_type {
 
 	lparen,
 	rparen,
+	separator, /* between the arguments of a function */
 };
 
 struct synge_op {
@@ -134,6 +152,7 @@ struct synge_op {
 
 		op_lparen,
 		op_rparen,
+		op_separator,
 
 		op_gt,
 		op_gteq,
@@ -188,12 +207,11 @@ void _print_stack(char *, struct stack *);
 void cheeky(char *, ...);
 struct synge_err to_error_code(int, int);
 
-synge_t *num_dup(synge_t);
 char *str_dup(char *);
 struct synge_op get_op(char *);
+char *get_op_str(int);
 struct synge_const get_special_num(char *);
 
-void synge_clear(void *);
 char *get_word(char *, char *, char **);
 bool contains_word(char *, char *, char *);
 char *trim_spaces(char *);
@@ -206,9 +224,17 @@ int grad_to_rad(synge_t, synge_t, mpfr_rnd_t);
 int rad_to_deg(synge_t, synge_t, mpfr_rnd_t);
 int rad_to_grad(synge_t, synge_t, mpfr_rnd_t);
 
-struct synge_err synge_lex_string(char *, struct stack **);
-struct synge_err synge_infix_parse(struct stack **, struct stack **);
-struct synge_err synge_eval_rpnstack(struct stack **, synge_t *);
-struct synge_err synge_internal_compute_string(char *, synge_t *, char *, int);
+struct synge_err synge_lex_string(struct synge_ctx *, char *, struct stack **);
+struct synge_err synge_infix_parse(struct synge_ctx *, struct stack **, struct stack **);
+struct synge_err synge_eval_string(struct synge_ctx *, char *, synge_t *, char *, int, bool);
+struct synge_err synge_internal_compute_string(struct synge_ctx *, char *, synge_t *, char *, int, bool);
+
+int trace_push(struct synge_ctx *, char *, int);
+void trace_keep(struct synge_ctx *, int);
+void trace_truncate(struct synge_ctx *, int);
+void trace_elide(struct synge_ctx *, int);
+
+void watch_start(struct synge_ctx *);
+int watch_check(struct synge_ctx *);
 
 #endif
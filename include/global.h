@@ -15,30 +15,142 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
+
 #include "synge.h"
 #include "common.h"
 #include "stack.h"
 #include "ohmic.h"
-#include "linked.h"
 
 #ifndef GLOBAL_H
 #define GLOBAL_H
 
-/* global state variables */
-extern int synge_started;
-extern gmp_randstate_t synge_state;
+/* an immutable layer of variables and functions, shared between contexts */
+struct synge_base {
+	struct ohm_t *variable_list;
+	struct ohm_t *expression_list;
+};
+
+/* where random numbers come from */
+struct synge_rand {
+	gmp_randstate_t state; /* gmp's generator (the default) */
+
+	/* counter-based stream, used instead of gmp's generator once one is chosen */
+	bool stream;
+	uint64_t key;
+	uint64_t counter;
+};
+
+/* what can stop an evaluation before it finishes */
+struct synge_watch {
+	struct synge_cancel *cancel; /* token to watch (or NULL) */
+	double deadline; /* time the current evaluation must finish by (or 0 for no limit) */
+	int code; /* why the current evaluation was interrupted (or SUCCESS) */
+
+	struct synge_budget limit; /* caps on the current evaluation */
+	struct synge_budget used; /* what the current evaluation has used so far */
+};
+
+/* arguments for builtin functions which take more than three of them (grown when needed, and reused between calls) */
+struct synge_scratch {
+	synge_t *values;
+	mpfr_ptr *args; /* pointers to the values, as the functions are given them */
+	int size;
+};
+
+/* snapshots of a context's words, published for readers on other threads */
+struct synge_publish {
+	bool enabled;
+	unsigned long version; /* bumped whenever the context's words may have changed */
+	struct synge_snapshot *latest; /* latest published snapshot (or NULL) */
+	int readers; /* readers part of the way through taking the latest snapshot */
+	struct synge_snapshot *retired; /* replaced snapshots the context still holds (until no reader can be taking them) */
+};
+
+/* the kinds of instructions in a compiled expression */
+enum {
+	vec_value, /* push a constant */
+	vec_column, /* push an input column */
+	vec_unary, /* apply an operator to the top of the stack */
+	vec_binary, /* apply an operator to the top two values of the stack */
+	vec_func, /* apply a builtin function to the top of the stack */
+	vec_select /* pick between the top two values of the stack by the third */
+};
+
+/* operators that only exist in compiled expressions */
+enum {
+	vec_neg = op_none + 1,
+	vec_pos
+};
+
+struct vec_func {
+	char *name;
+	double (*get)(double);
+};
 
-/* variables and functions */
-extern struct ohm_t *variable_list;
-extern struct ohm_t *expression_list;
-extern synge_t prev_answer;
+struct vec_instruction {
+	int kind;
+	int op; /* operator, column, constant index or function flags */
+	double value;
+	struct vec_func *func;
+};
 
-/* traceback */
-extern char *error_msg_container;
-extern struct link_t *traceback_list;
+/* an expression compiled into a flat list of instructions */
+struct synge_vector {
+	struct vec_instruction *code;
+	int length;
+	int size;
+
+	int depth; /* largest stack needed */
+	int columns;
+
+	/* full precision values of the constants */
+	synge_t *constants;
+	int nconstants;
+
+	int mode; /* the context's angle mode */
+	double to_rad, from_rad; /* angle conversions for the mode */
+};
+
+/* all of the state belonging to a single instance of the engine */
+struct synge_ctx {
+	/* variables and functions (looked up before the base layer's) */
+	struct ohm_t *variable_list;
+	struct ohm_t *expression_list;
+	synge_t prev_answer;
+
+	struct synge_base *base; /* shared words underneath the context's own (or NULL) */
+	struct ohm_t *hidden_list; /* base words which have been deleted in this context */
+
+	/* formatted numbers */
+	char *number_str_container;
+	int number_str_size;
+
+	/* traceback */
+	char *error_msg_container;
+	int error_msg_size;
+	struct synge_trace traceback_list;
+
+	struct synge_settings settings;
+	struct synge_rand random;
+	struct synge_watch watch;
+	struct synge_publish publish;
+	struct synge_scratch scratch;
+};
+
+/* context used by the global interface */
+extern struct synge_ctx *default_ctx;
 
 /* default settings */
-extern struct synge_settings active_settings;
+extern struct synge_settings default_settings;
+
+uint64_t stream_key(uint64_t, uint64_t);
+synge_t *get_variable(struct synge_ctx *, char *);
+char *get_function(struct synge_ctx *, char *);
+void publish_words(struct synge_ctx *);
+char *answer_expression(char *);
+bool answer_changes(struct synge_ctx *, char *);
+void set_answer(struct synge_ctx *, char *, synge_t);
 
 /* builtin lists */
 extern struct synge_func func_list[];
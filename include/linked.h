@@ -20,7 +20,10 @@ struct link_node {
 
 struct link_t {
 	struct link_node *chain;
+	struct link_node *tail; /* last link, so the end can be reached without walking the chain */
 	int length;
+
+	void *pop_container; /* holds the content of the last popped link */
 };
 
 struct link_iter {
@@ -55,6 +58,7 @@ void *link_pop(struct link_t *, int);
 
 int link_shorten(struct link_t *, int);
 int link_truncate(struct link_t *, int);
+int link_length(struct link_t *);
 
 struct link_iter *link_iter_init(struct link_t *);
 int link_iter_next(struct link_iter *);
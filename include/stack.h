@@ -15,17 +15,42 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "synge.h"
+
 #ifndef SYNGE_STACK_H
 #define SYNGE_STACK_H
 
 /* stack types */
 
+/* what (if anything) is stored in a stack_cont's value */
+enum stack_tag {
+	tag_none,
+	tag_number, /* initialised synge_t, owned by the stack */
+	tag_integer, /* number which is a small integer (so it doesn't need a synge_t) */
+	tag_bigint, /* initialised mpz_t, for exact integers too large for a long, owned by the stack */
+	tag_rational, /* initialised canonical mpq_t, for exact fractions (only in exact mode), owned by the stack */
+	tag_string, /* heap string, owned by the stack */
+	tag_span, /* borrowed string (static or owned by another stack) */
+	tag_func, /* pointer into the builtin function list */
+	tag_op /* operator enumeration value */
+};
+
 struct stack_cont {
-	void *val;
 	int tp;
-	int tofree;
-	void (*freefunc)(void *);
+	int tag;
 	int position;
+	int count; /* arguments given to a function (or separated within a bracket) */
+
+	/* values are stored inline, so numbers don't need a separate allocation */
+	union {
+		synge_t num;
+		long integer;
+		mpz_t bigint;
+		mpq_t rational;
+		char *str;
+		struct synge_func *func;
+		int op;
+	} val;
 };
 
 struct stack {
@@ -38,11 +63,22 @@ struct stack {
 
 void init_stack(struct stack *); /* initialize the struct stack */
 
-void push_valstack(void *, int, int, void (*)(void *), int, struct stack *); /* push value and type to the top of the struct stack */
-void push_ststack(struct stack_cont, struct stack *); /* push struct to the top of the struct stack */
+void push_numstack(synge_t, int, int, struct stack *); /* push a copy of a number and its type to the top of the struct stack */
+void push_intstack(long, int, int, struct stack *); /* push a small integer and its type to the top of the struct stack */
+void push_bigstack(mpz_t, int, int, struct stack *); /* push a copy of an exact integer and its type to the top of the struct stack */
+void push_ratstack(mpq_t, int, int, struct stack *); /* push a copy of an exact fraction and its type to the top of the struct stack */
+void push_strstack(char *, int, bool, int, struct stack *); /* push a string (owned if true) and its type to the top of the struct stack */
+void push_funcstack(struct synge_func *, int, int, struct stack *); /* push a builtin function and its type to the top of the struct stack */
+void push_opstack(int, int, int, struct stack *); /* push an operator and its type to the top of the struct stack */
+
+void push_ststack(struct stack_cont, struct stack *); /* push struct to the top of the struct stack (taking ownership of its value) */
+void move_ststack(struct stack_cont *, struct stack *); /* move struct to the top of the struct stack (the old struct no longer owns its value) */
 
 struct stack_cont *pop_stack(struct stack *); /* pops the top value on the struct stack */
 struct stack_cont *top_stack(struct stack *); /* returns the top value on the struct stack */
+void get_numstack(struct stack_cont *, synge_t); /* copy a number (whichever way it is stored) into a synge_t */
+void get_bigstack(struct stack_cont *, mpz_t, mpfr_rnd_t); /* copy a number (whichever way it is stored) into an integer, rounding it if needed */
+void get_ratstack(struct stack_cont *, mpq_t); /* copy an exact number (an integer or fraction) into a rational */
 
 void free_stack_cont(struct stack_cont *); /* frees and clears the stack content struct */
 void free_stack(struct stack *); /* frees and clears the struct stack */
@@ -90,6 +90,11 @@ struct synge_err {
 		ERROR_DELETE,
 		UNDEFINED,
 		TOO_DEEP,
+		TIMEOUT,
+		CANCELLED,
+		STEP_LIMIT,
+		MEMORY_LIMIT,
+		CALL_LIMIT,
 		UNKNOWN_ERROR
 	} code;
 	int position;
@@ -117,7 +122,33 @@ struct synge_settings {
 		strict
 	} strict;
 
+	enum {
+		approximate,
+		exact
+	} arithmetic; /* whether + - * / (and powers) keep decimal literals as exact fractions */
+
 	int precision;
+	int depth; /* maximum depth of nested user function calls and conditionals */
+	int tails; /* maximum number of consecutive tail calls (which don't count towards the depth) */
+	int timeout; /* maximum time (in milliseconds) a single evaluation may take, or 0 for no limit */
+};
+
+/* caps on what a single evaluation may use (0 for no limit), or what an evaluation actually used */
+struct synge_budget {
+	long steps; /* instructions executed (including those of user functions and conditionals) */
+	long memory; /* bytes allocated for numbers and strings */
+	long calls; /* user function calls */
+};
+
+enum {
+	func_random = 1, /* get() is also given the context's random number generator, after the rounding mode */
+	func_angle_in = 2, /* the argument is an angle in the context's mode (get() is given it in radians) */
+	func_angle_out = 4 /* the result is an angle in the context's mode (get() gives it in radians) */
+};
+
+/* number of arguments of a function which takes any number of them */
+enum {
+	variadic = -1
 };
 
 struct synge_func {
@@ -126,8 +157,12 @@ struct synge_func {
 	char *prototype;
 	char *description;
 
-	/* a function pointer with the same format as the mpfr_* functions */
+	/* a function pointer with the same format as the mpfr_* functions (variadic functions are given an array of
+	 * copies of their arguments, which they may overwrite, and its length, like mpfr_sum()) */
 	int (*get)();
+	int args; /* number of arguments (or variadic) -- several functions can share a name if they take different numbers */
+
+	int flags;
 };
 
 struct synge_word {
@@ -135,21 +170,165 @@ struct synge_word {
 	char *description;
 };
 
+/* an independent instance of the synge engine (its own variables, functions, settings, traceback and random state).
+ * separate contexts can be used concurrently from different threads, but a single context mustn't be. */
+struct synge_ctx;
+
+__EXPORT struct synge_ctx *synge_ctx_new(void); /* create a new context with the default settings */
+__EXPORT struct synge_ctx *synge_ctx_dup(struct synge_ctx *); /* create a new context with a copy of another's words, settings and random state */
+
+/* a read-only layer of variables and functions which any number of contexts (on any number of threads) can be
+ * placed on top of. a context's own words shadow the base's, and changes to words never touch the base. */
+struct synge_base;
+
+__EXPORT struct synge_base *synge_base_new(struct synge_ctx *); /* create a base layer from the words visible in a context */
+__EXPORT void synge_base_free(struct synge_base *); /* free a base layer (which must no longer be used by any context or snapshot) */
+__EXPORT void synge_ctx_set_base(struct synge_ctx *, struct synge_base *); /* place a context on top of a base layer (or none, if NULL) */
+__EXPORT void synge_ctx_free(struct synge_ctx *); /* free a context and everything it holds */
+
+/* a consistent, read-only copy of a context's variables and functions as they were between two of its evaluations.
+ * once a context publishes snapshots, they can be taken and read on any thread while the context carries on
+ * evaluating -- snapshots are swapped in and reference counted atomically, so the reader never waits for an evaluation
+ * and the context never waits for readers. each snapshot is a copy of the context's own words (taken after every
+ * evaluation which changes them), while its base layer is shared rather than copied. */
+struct synge_snapshot;
+
+__EXPORT void synge_ctx_publish(struct synge_ctx *, bool); /* start (or stop) publishing a snapshot after each evaluation which changes words */
+__EXPORT struct synge_snapshot *synge_ctx_get_snapshot(struct synge_ctx *); /* take the latest snapshot (or NULL if it isn't publishing) */
+__EXPORT void synge_snapshot_release(struct synge_snapshot *); /* let go of a snapshot taken above */
+__EXPORT unsigned long synge_snapshot_version(struct synge_snapshot *); /* differs between snapshots with (possibly) different words */
+__EXPORT struct ohm_t *synge_snapshot_variable_list(struct synge_snapshot *); /* (only the context's own words -- DO NOT MODIFY, valid until released) */
+__EXPORT struct ohm_t *synge_snapshot_expression_list(struct synge_snapshot *);
+__EXPORT synge_t *synge_snapshot_get_variable(struct synge_snapshot *, char *); /* look up a variable, in its base layer too (or NULL) */
+__EXPORT char *synge_snapshot_get_expression(struct synge_snapshot *, char *); /* look up a user function, in its base layer too (or NULL) */
+
+/* a flag which stops any evaluation watching it (with a CANCELLED error) once it is set. it can be set from any thread,
+ * and stays set until it is reset -- so one token can stop a whole batch. */
+struct synge_cancel;
+
+__EXPORT struct synge_cancel *synge_cancel_new(void);
+__EXPORT void synge_cancel_free(struct synge_cancel *); /* (must no longer be watched by any context) */
+__EXPORT void synge_cancel_set(struct synge_cancel *);
+__EXPORT void synge_cancel_reset(struct synge_cancel *);
+__EXPORT bool synge_cancel_is_set(struct synge_cancel *);
+__EXPORT void synge_ctx_set_cancel(struct synge_ctx *, struct synge_cancel *); /* make a context's evaluations watch a token (or none, if NULL) */
+
+__EXPORT int synge_ctx_get_precision(struct synge_ctx *, synge_t);
+__EXPORT int synge_ctx_format_number(struct synge_ctx *, synge_t, char *, size_t);
+__EXPORT char *synge_ctx_number_str(struct synge_ctx *, synge_t); /* (DO NOT FREE -- valid until the next call on the context) */
+__EXPORT struct synge_settings synge_ctx_get_settings(struct synge_ctx *);
+__EXPORT void synge_ctx_set_settings(struct synge_ctx *, struct synge_settings);
+__EXPORT struct ohm_t *synge_ctx_get_variable_list(struct synge_ctx *); /* (only the context's own words, not its base layer's) */
+__EXPORT struct ohm_t *synge_ctx_get_expression_list(struct synge_ctx *);
+__EXPORT int synge_ctx_format_error(struct synge_ctx *, struct synge_err, char *, size_t);
+__EXPORT char *synge_ctx_error_msg(struct synge_ctx *, struct synge_err); /* (DO NOT FREE -- valid until the next call on the context) */
+__EXPORT char *synge_ctx_error_msg_pos(struct synge_ctx *, int, int);
+__EXPORT struct synge_err synge_ctx_compute_string(struct synge_ctx *, char *, synge_t *);
+__EXPORT struct synge_err synge_ctx_compute_budget(struct synge_ctx *, char *, synge_t *, struct synge_budget *, struct synge_budget *);
+__EXPORT struct synge_err synge_ctx_compute_interval(struct synge_ctx *, char *, synge_t *);
+__EXPORT void synge_ctx_compute_batch(struct synge_ctx *, char **, int, synge_t *, struct synge_err *, int);
+__EXPORT void synge_ctx_tabulate(struct synge_ctx *, char *, char *, synge_t, synge_t, int, synge_t *, struct synge_err *, int);
+__EXPORT void synge_ctx_seed(struct synge_ctx *, unsigned int);
+__EXPORT void synge_ctx_seed_stream(struct synge_ctx *, unsigned long, unsigned long);
+__EXPORT void synge_ctx_reset_traceback(struct synge_ctx *);
+
+/* a queue which evaluates expressions on its own thread, one after another, against a context (which mustn't be used
+ * by anything else until the queue is freed). it lets a single-threaded host keep evaluations going without blocking. */
+struct synge_async;
+
+/* a finished asynchronous evaluation */
+struct synge_result {
+	int ticket; /* as returned when the expression was submitted */
+	struct synge_err error;
+	synge_t value;
+	char *message; /* the error message (with the traceback, if enabled), or NULL if it succeeded */
+};
+
+/* called on the queue's thread once an expression has been evaluated (the result is freed once it returns) */
+typedef void (*synge_callback)(struct synge_result *, void *);
+
+__EXPORT struct synge_async *synge_async_new(struct synge_ctx *, int); /* start a queue which can have up to the given number of expressions in flight */
+
+/* cancels the current evaluation through the context's cancellation token (which the queue gives the context if it doesn't
+ * have one, and which is only set until the evaluation has stopped), dropping any others which haven't started */
+__EXPORT void synge_async_free(struct synge_async *);
+
+/* submit an expression, returning its ticket (or -1 if the queue is full). if a callback is given, it is called with
+ * the result -- otherwise the result is kept until it is collected (which frees up its place in the queue). */
+__EXPORT int synge_async_submit(struct synge_async *, char *, synge_callback, void *);
+
+/* returns a descriptor which becomes readable when results are waiting to be collected (or -1 if there isn't one).
+ * once it is readable, keep collecting until there are no more results. */
+__EXPORT int synge_async_fd(struct synge_async *);
+__EXPORT struct synge_result *synge_async_collect(struct synge_async *); /* returns the next result to have finished (or NULL) */
+__EXPORT void synge_result_free(struct synge_result *); /* free a collected result */
+
+/* an expression compiled for evaluating over columns of double precision inputs. compiling fixes the context's other
+ * variables, user functions (which are inlined) and angle mode, so the context is no longer needed afterwards. */
+struct synge_vector;
+
+__EXPORT struct synge_vector *synge_ctx_vector_compile(struct synge_ctx *, char *, char **, int, struct synge_err *);
+__EXPORT void synge_vector_free(struct synge_vector *);
+
+/* evaluates a compiled expression for the given number of rows, with each of its variables read from the matching column.
+ * rows which can't be evaluated (dividing by zero and so on) give NaN. it doesn't change the compiled expression, so
+ * it can be run from several threads at once. */
+__EXPORT void synge_vector_run(struct synge_vector *, double **, int, double *);
+
+/* the functions below act on a default context, created by synge_start() and freed by synge_end() */
+
 __EXPORT int synge_get_precision(synge_t); /* returns minimum decimal precision needed to print number */
 
+/* writes a number into the given buffer of the given size, the same way as "%.*Rf" with synge_get_precision(), returning
+ * the full length like snprintf(). the number is only converted to decimal once. */
+__EXPORT int synge_format_number(synge_t, char *, size_t);
+__EXPORT char *synge_number_str(synge_t); /* same as above, except into a buffer which is reused between calls (DO NOT FREE) */
+
 __EXPORT struct synge_settings synge_get_settings(void); /* returns active settings */
 __EXPORT void synge_set_settings(struct synge_settings); /* set active settings to given settings */
 
 __EXPORT struct synge_func *synge_get_function_list(void); /* returns list of available builtin functions */
 __EXPORT struct ohm_t *synge_get_variable_list(void); /* returns list of variables */
 __EXPORT struct ohm_t *synge_get_expression_list(void); /* returns list of user functions */
+__EXPORT void synge_publish(bool); /* start (or stop) publishing snapshots of the variables and user functions */
+__EXPORT struct synge_snapshot *synge_get_snapshot(void); /* returns the latest snapshot (must be released) -- safe to use during evaluation */
 __EXPORT struct synge_word *synge_get_constant_list(void); /* returns list of builtin constants (must be freed) */
 
+/* writes the message describing the error code (with the traceback, if enabled) into the given buffer of the given size,
+ * returning the full length of the message like snprintf(). it never allocates, so it is safe to use on worker threads. */
+__EXPORT int synge_format_error(struct synge_err, char *, size_t);
+
 __EXPORT char *synge_error_msg(struct synge_err); /* returns a string which describes the error code (DO NOT FREE) */
 __EXPORT char *synge_error_msg_pos(int, int); /* same as above, except takes the internal position and code values as args (DO NOT FREE) */
 
 __EXPORT struct synge_err synge_compute_string(char *, synge_t *); /* takes an infix-style string and runs it through the synge core */
 
+/* same as above, except the evaluation fails (with STEP_LIMIT, MEMORY_LIMIT or CALL_LIMIT) once it goes over the given
+ * budget (if not NULL), and what it used is stored in the second budget (if not NULL) -- even if it failed */
+__EXPORT struct synge_err synge_compute_budget(char *, synge_t *, struct synge_budget *, struct synge_budget *);
+
+/* same as above, except the result is first bounded with interval arithmetic at a low precision, which is raised until
+ * both ends of the bounds print the same (to the precision synge_get_precision() would use). anything which can't be
+ * bounded below SYNGE_PRECISION, or which changes words, is computed by the engine as usual. the result is only as
+ * precise as the digits it prints. */
+__EXPORT struct synge_err synge_compute_interval(char *, synge_t *);
+
+/* computes an array of independent expressions on a pool of threads (0 threads means one per core), storing the results
+ * and error codes in the given arrays in input order. every expression sees the words as they were before the batch,
+ * and any changes it makes to them are discarded. if a random stream is in use, each expression gets its own sub-stream. */
+__EXPORT void synge_compute_batch(char **, int, synge_t *, struct synge_err *, int);
+
+/* computes an expression at the given number of evenly spaced points from one value to another (inclusive), with the
+ * given variable bound to each point in turn. the points are shared out between a pool of threads (0 threads means one
+ * per core) which steal from each other once they run out, and the results and error codes are stored in the given
+ * arrays in order. like a batch, the words are left as they were. */
+__EXPORT void synge_tabulate(char *, char *, synge_t, synge_t, int, synge_t *, struct synge_err *, int);
+
+/* compiles an expression of the given variables (which become the columns, in order) for synge_vector_run(), returning
+ * NULL and storing the error code if it can't be compiled. only pure expressions can be compiled -- they can't change
+ * words, use random numbers or call recursive functions. */
+__EXPORT struct synge_vector *synge_vector_compile(char *, char **, int, struct synge_err *);
+
 /* returns true if the return code should be treated as a success, otherwise false */
 #define synge_is_success_code(code) \
 	(code == SUCCESS)
@@ -158,7 +337,13 @@ __EXPORT struct synge_err synge_compute_string(char *, synge_t *); /* takes an i
 #define synge_is_ignore_code(code) \
 	(code == EMPTY_STACK || code == ERROR_FUNC_ASSIGNMENT || code == ERROR_DELETE)
 
+__EXPORT void synge_set_cancel(struct synge_cancel *); /* make evaluations watch a cancellation token (or none, if NULL) */
+
 __EXPORT void synge_seed(unsigned int seed); /* seed synge's pseudorandom number generator */
+
+/* switch to a counter-based random stream, given by a seed and a stream number. the same seed and stream always
+ * give the same sequence, and different streams of a seed are independent (so each worker can have its own). */
+__EXPORT void synge_seed_stream(unsigned long seed, unsigned long stream);
 __EXPORT void synge_start(void); /* run at program initiation -- assertion will fail if not run before using synge functions */
 __EXPORT void synge_end(void); /* run at program termination -- memory WILL leak if not run at end */
 
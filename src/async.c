@@ -0,0 +1,319 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "synge.h"
+#include "global.h"
+#include "common.h"
+
+#if defined(_WINDOWS)
+	/* no pollable descriptor -- completions are only signalled through callbacks */
+#elif defined(__linux__)
+#	include <unistd.h>
+#	include <sys/eventfd.h>
+#else
+#	include <unistd.h>
+#	include <fcntl.h>
+#endif
+
+/* a submitted expression, which becomes its own result once it has been evaluated */
+struct async_job {
+	struct synge_result result;
+
+	char *expression;
+	synge_callback callback;
+	void *data;
+
+	struct async_job *next;
+};
+
+/* a first-in first-out list of jobs */
+struct async_list {
+	struct async_job *head;
+	struct async_job *tail;
+};
+
+struct synge_async {
+	struct synge_ctx *ctx;
+	pthread_t thread;
+
+	pthread_mutex_t lock; /* guards everything below */
+	pthread_cond_t wake; /* signalled when a job is submitted or the queue is shutting down */
+
+	struct async_list pending; /* submitted, but not yet evaluated */
+	struct async_list done; /* evaluated, but not yet collected */
+
+	int in_flight; /* jobs which have been submitted but not collected (or called back) */
+	int size; /* maximum number of jobs in flight */
+	int next_ticket;
+	bool stopping;
+
+	int notify[2]; /* read and write ends of the completion descriptor (both -1 if there isn't one) */
+
+	struct synge_cancel *own_cancel; /* token given to the context for the queue's lifetime (or NULL if it had one) */
+};
+
+static void list_push(struct async_list *list, struct async_job *job) {
+	job->next = NULL;
+
+	if(list->tail)
+		list->tail->next = job;
+	else
+		list->head = job;
+
+	list->tail = job;
+} /* list_push() */
+
+static struct async_job *list_pop(struct async_list *list) {
+	struct async_job *job = list->head;
+
+	if(job) {
+		list->head = job->next;
+		if(!list->head)
+			list->tail = NULL;
+	}
+
+	return job;
+} /* list_pop() */
+
+static void job_free(struct async_job *job) {
+	mpfr_clear(job->result.value);
+	free(job->result.message);
+	free(job->expression);
+	free(job);
+} /* job_free() */
+
+static void notify_open(struct synge_async *async) {
+#if defined(_WINDOWS)
+	async->notify[0] = async->notify[1] = -1;
+#elif defined(__linux__)
+	async->notify[0] = async->notify[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#else
+	if(pipe(async->notify) < 0)
+		async->notify[0] = async->notify[1] = -1;
+	else {
+		fcntl(async->notify[0], F_SETFL, O_NONBLOCK);
+		fcntl(async->notify[1], F_SETFL, O_NONBLOCK);
+	}
+#endif
+} /* notify_open() */
+
+static void notify_close(struct synge_async *async) {
+#if !defined(_WINDOWS)
+	if(async->notify[0] >= 0)
+		close(async->notify[0]);
+
+	if(async->notify[1] != async->notify[0])
+		close(async->notify[1]);
+#endif
+} /* notify_close() */
+
+/* make the completion descriptor readable */
+static void notify_signal(struct synge_async *async) {
+#if !defined(_WINDOWS)
+	uint64_t one = 1;
+
+	/* a full pipe is already readable, so a failed write doesn't matter */
+	if(async->notify[1] >= 0 && write(async->notify[1], &one, sizeof(one)) < 0)
+		return;
+#endif
+} /* notify_signal() */
+
+/* clear the completion descriptor, before checking for completions (so none are missed) */
+static void notify_drain(struct synge_async *async) {
+#if !defined(_WINDOWS)
+	uint64_t buf[16];
+
+	if(async->notify[0] >= 0)
+		while(read(async->notify[0], buf, sizeof(buf)) > 0)
+			;
+#endif
+} /* notify_drain() */
+
+static void *async_thread(void *arg) {
+	struct synge_async *async = arg;
+
+	while(true) {
+		pthread_mutex_lock(&async->lock);
+		while(!async->pending.head && !async->stopping)
+			pthread_cond_wait(&async->wake, &async->lock);
+
+		struct async_job *job = async->stopping ? NULL : list_pop(&async->pending);
+		pthread_mutex_unlock(&async->lock);
+
+		if(!job)
+			break;
+
+		job->result.error = synge_internal_compute_string(async->ctx, job->expression, &job->result.value, SYNGE_MAIN, 0, false);
+
+		/* the message has to be made now, as the traceback is overwritten by the next evaluation */
+		if(!synge_is_success_code(job->result.error.code)) {
+			int len = synge_ctx_format_error(async->ctx, job->result.error, NULL, 0);
+
+			job->result.message = malloc(len + 1);
+			synge_ctx_format_error(async->ctx, job->result.error, job->result.message, len + 1);
+		}
+
+		if(job->callback) {
+			job->callback(&job->result, job->data);
+			job_free(job);
+
+			pthread_mutex_lock(&async->lock);
+			async->in_flight--;
+			pthread_mutex_unlock(&async->lock);
+		} else {
+			pthread_mutex_lock(&async->lock);
+			list_push(&async->done, job);
+			pthread_mutex_unlock(&async->lock);
+
+			notify_signal(async);
+		}
+	}
+
+	/* mpfr's caches are per-thread */
+	mpfr_free_cache();
+	return NULL;
+} /* async_thread() */
+
+struct synge_async *synge_async_new(struct synge_ctx *ctx, int size) {
+	assert(ctx != NULL, "synge context must be initialised");
+
+	struct synge_async *async = malloc(sizeof(struct synge_async));
+
+	async->ctx = ctx;
+	async->pending = (struct async_list) {NULL, NULL};
+	async->done = (struct async_list) {NULL, NULL};
+	async->in_flight = 0;
+	async->size = size > 0 ? size : 1;
+	async->next_ticket = 0;
+	async->stopping = false;
+
+	/* freeing the queue stops the running evaluation through the context's token, so it needs one */
+	async->own_cancel = NULL;
+	if(!ctx->watch.cancel) {
+		async->own_cancel = synge_cancel_new();
+		synge_ctx_set_cancel(ctx, async->own_cancel);
+	}
+
+	pthread_mutex_init(&async->lock, NULL);
+	pthread_cond_init(&async->wake, NULL);
+	notify_open(async);
+
+	if(pthread_create(&async->thread, NULL, async_thread, async)) {
+		if(async->own_cancel) {
+			synge_ctx_set_cancel(ctx, NULL);
+			synge_cancel_free(async->own_cancel);
+		}
+
+		notify_close(async);
+		pthread_cond_destroy(&async->wake);
+		pthread_mutex_destroy(&async->lock);
+		free(async);
+		return NULL;
+	}
+
+	return async;
+} /* synge_async_new() */
+
+void synge_async_free(struct synge_async *async) {
+	struct synge_cancel *token = async->ctx->watch.cancel;
+	bool was_set = synge_cancel_is_set(token);
+
+	/* no more evaluations are started once it is stopping, so the token only ever cancels the running one (if any) */
+	pthread_mutex_lock(&async->lock);
+	async->stopping = true;
+	pthread_cond_signal(&async->wake);
+	pthread_mutex_unlock(&async->lock);
+
+	synge_cancel_set(token);
+	pthread_join(async->thread, NULL);
+
+	if(async->own_cancel) {
+		synge_ctx_set_cancel(async->ctx, NULL);
+		synge_cancel_free(async->own_cancel);
+	} else if(!was_set)
+		synge_cancel_reset(token);
+
+	struct async_job *job;
+	while((job = list_pop(&async->pending)))
+		job_free(job);
+
+	while((job = list_pop(&async->done)))
+		job_free(job);
+
+	notify_close(async);
+	pthread_cond_destroy(&async->wake);
+	pthread_mutex_destroy(&async->lock);
+	free(async);
+} /* synge_async_free() */
+
+int synge_async_submit(struct synge_async *async, char *expression, synge_callback callback, void *data) {
+	pthread_mutex_lock(&async->lock);
+
+	/* never block the caller -- a full queue is its problem */
+	if(async->in_flight >= async->size) {
+		pthread_mutex_unlock(&async->lock);
+		return -1;
+	}
+
+	struct async_job *job = malloc(sizeof(struct async_job));
+	int ticket = async->next_ticket++;
+
+	job->result.ticket = ticket;
+	job->result.message = NULL;
+	mpfr_init2(job->result.value, SYNGE_PRECISION);
+
+	job->expression = str_dup(expression);
+	job->callback = callback;
+	job->data = data;
+
+	list_push(&async->pending, job);
+	async->in_flight++;
+
+	pthread_cond_signal(&async->wake);
+	pthread_mutex_unlock(&async->lock);
+
+	/* (the job may already have been freed by now) */
+	return ticket;
+} /* synge_async_submit() */
+
+int synge_async_fd(struct synge_async *async) {
+	return async->notify[0];
+} /* synge_async_fd() */
+
+struct synge_result *synge_async_collect(struct synge_async *async) {
+	notify_drain(async);
+
+	pthread_mutex_lock(&async->lock);
+	struct async_job *job = list_pop(&async->done);
+
+	if(job)
+		async->in_flight--;
+	pthread_mutex_unlock(&async->lock);
+
+	/* the result is the first member of the job, so it can be freed through its result */
+	return job ? &job->result : NULL;
+} /* synge_async_collect() */
+
+void synge_result_free(struct synge_result *result) {
+	job_free((struct async_job *) result);
+} /* synge_result_free() */
@@ -0,0 +1,364 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "synge.h"
+#include "global.h"
+#include "common.h"
+
+#if defined(_WINDOWS)
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+/* the expressions shared by every worker in a batch */
+struct batch_job {
+	struct synge_ctx *base;
+
+	char **expressions;
+	synge_t *results;
+	struct synge_err *errors;
+	int count;
+
+	int next; /* next expression to be claimed by a worker */
+	pthread_mutex_t lock;
+};
+
+struct batch_worker {
+	struct batch_job *job;
+	struct synge_ctx *ctx; /* private copy of the base context */
+	pthread_t thread;
+};
+
+static int get_cores(void) {
+#if defined(_WINDOWS)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+} /* get_cores() */
+
+/* claim the next unevaluated expression (or -1 if there are none left) */
+static int batch_claim(struct batch_job *job) {
+	int index = -1;
+
+	pthread_mutex_lock(&job->lock);
+	if(job->next < job->count)
+		index = job->next++;
+	pthread_mutex_unlock(&job->lock);
+
+	return index;
+} /* batch_claim() */
+
+static void batch_run(struct batch_worker *worker) {
+	struct batch_job *job = worker->job;
+	int i;
+
+	while((i = batch_claim(job)) >= 0) {
+		/* every expression sees the same previous answer */
+		mpfr_set(worker->ctx->prev_answer, job->base->prev_answer, SYNGE_ROUND);
+
+		/* with a random stream, each expression gets its own sub-stream (so the results don't depend on scheduling) */
+		if(job->base->random.stream) {
+			worker->ctx->random.key = stream_key(job->base->random.key, i);
+			worker->ctx->random.counter = 0;
+		}
+
+		job->errors[i] = synge_internal_compute_string(worker->ctx, job->expressions[i], &job->results[i], SYNGE_MAIN, 0, true);
+	}
+} /* batch_run() */
+
+static void *batch_thread(void *arg) {
+	batch_run(arg);
+
+	/* mpfr's caches are per-thread */
+	mpfr_free_cache();
+	return NULL;
+} /* batch_thread() */
+
+void synge_ctx_compute_batch(struct synge_ctx *ctx, char **expressions, int count, synge_t *results, struct synge_err *errors, int threads) {
+	assert(ctx != NULL, "synge context must be initialised");
+
+	/* one thread per core by default, but never more threads than expressions */
+	if(threads < 1)
+		threads = get_cores();
+
+	if(threads > count)
+		threads = count;
+
+	if(threads < 1)
+		threads = 1;
+
+	struct batch_job job = {
+		.base = ctx,
+		.expressions = expressions,
+		.results = results,
+		.errors = errors,
+		.count = count,
+		.next = 0
+	};
+
+	pthread_mutex_init(&job.lock, NULL);
+
+	/* workers get their own copy of the context (so they never touch each other's state) and their own seed */
+	struct batch_worker *workers = malloc(threads * sizeof(struct batch_worker));
+
+	int i;
+	for(i = 0; i < threads; i++) {
+		workers[i].job = &job;
+		workers[i].ctx = synge_ctx_dup(ctx);
+		gmp_randseed_ui(workers[i].ctx->random.state, gmp_urandomb_ui(ctx->random.state, 32));
+	}
+
+	/* the calling thread is the first worker */
+	for(i = 1; i < threads; i++)
+		if(pthread_create(&workers[i].thread, NULL, batch_thread, &workers[i]))
+			break;
+
+	/* threads which couldn't be started are simply left out -- the other workers pick up the slack */
+	int started = i;
+
+	batch_run(&workers[0]);
+
+	for(i = 1; i < started; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	for(i = 0; i < threads; i++)
+		synge_ctx_free(workers[i].ctx);
+
+	free(workers);
+	pthread_mutex_destroy(&job.lock);
+} /* synge_ctx_compute_batch() */
+
+void synge_compute_batch(char **expressions, int count, synge_t *results, struct synge_err *errors, int threads) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_compute_batch(default_ctx, expressions, count, results, errors, threads);
+} /* synge_compute_batch() */
+
+/* the points of a tabulation which a worker has yet to evaluate -- it takes them from the front,
+ * and idle workers steal them from the back */
+struct tab_range {
+	int next;
+	int end;
+	pthread_mutex_t lock;
+};
+
+/* the tabulation shared by every worker */
+struct tab_job {
+	struct synge_ctx *base;
+
+	char *expression;
+	char *variable;
+	synge_t from, step;
+	synge_t *results;
+	struct synge_err *errors;
+	int count;
+
+	struct tab_range *ranges;
+	int threads;
+};
+
+struct tab_worker {
+	struct tab_job *job;
+	struct synge_ctx *ctx; /* private copy of the base context */
+	int id;
+	pthread_t thread;
+};
+
+/* take the next point from a range (or -1 if it is empty) */
+static int tab_take(struct tab_range *range) {
+	int index = -1;
+
+	pthread_mutex_lock(&range->lock);
+	if(range->next < range->end)
+		index = range->next++;
+	pthread_mutex_unlock(&range->lock);
+
+	return index;
+} /* tab_take() */
+
+/* steal the back half of another worker's points, returning the first of them (or -1 if every worker has run dry) */
+static int tab_steal(struct tab_job *job, int thief) {
+	int i;
+	for(i = 1; i < job->threads; i++) {
+		struct tab_range *victim = &job->ranges[(thief + i) % job->threads];
+		int start = -1, end = -1;
+
+		pthread_mutex_lock(&victim->lock);
+		if(victim->next < victim->end) {
+			start = victim->next + (victim->end - victim->next) / 2;
+			end = victim->end;
+			victim->end = start;
+		}
+		pthread_mutex_unlock(&victim->lock);
+
+		if(start < 0)
+			continue;
+
+		/* the rest of the stolen points become the thief's own (which can in turn be stolen) */
+		struct tab_range *own = &job->ranges[thief];
+
+		pthread_mutex_lock(&own->lock);
+		own->next = start + 1;
+		own->end = end;
+		pthread_mutex_unlock(&own->lock);
+
+		return start;
+	}
+
+	return -1;
+} /* tab_steal() */
+
+static void tab_run(struct tab_worker *worker) {
+	struct tab_job *job = worker->job;
+	struct synge_ctx *ctx = worker->ctx;
+	int i, keylen = strlen(job->variable) + 1;
+
+	while((i = tab_take(&job->ranges[worker->id])) >= 0 || (i = tab_steal(job, worker->id)) >= 0) {
+		/* every point sees the same previous answer */
+		mpfr_set(ctx->prev_answer, job->base->prev_answer, SYNGE_ROUND);
+
+		/* with a random stream, each point gets its own sub-stream (so the results don't depend on scheduling) */
+		if(job->base->random.stream) {
+			ctx->random.key = stream_key(job->base->random.key, i);
+			ctx->random.counter = 0;
+		}
+
+		/* bind the variable to the point (the previous evaluation's changes have been discarded, so it is still there) */
+		synge_t *value = ohm_search(ctx->variable_list, job->variable, keylen);
+		mpfr_mul_si(*value, job->step, i, SYNGE_ROUND);
+		mpfr_add(*value, *value, job->from, SYNGE_ROUND);
+
+		job->errors[i] = synge_internal_compute_string(ctx, job->expression, &job->results[i], SYNGE_MAIN, 0, true);
+	}
+} /* tab_run() */
+
+static void *tab_thread(void *arg) {
+	tab_run(arg);
+
+	/* mpfr's caches are per-thread */
+	mpfr_free_cache();
+	return NULL;
+} /* tab_thread() */
+
+/* whether a string can be used as the name of a variable */
+static bool valid_variable(char *s) {
+	return *s && strspn(s, SYNGE_WORD_CHARS) == strlen(s) && strcmp(s, SYNGE_PREV_EXPRESSION);
+} /* valid_variable() */
+
+void synge_ctx_tabulate(struct synge_ctx *ctx, char *expression, char *variable, synge_t from, synge_t to, int count,
+		synge_t *results, struct synge_err *errors, int threads) {
+	assert(ctx != NULL, "synge context must be initialised");
+
+	int i;
+	if(!valid_variable(variable)) {
+		for(i = 0; i < count; i++) {
+			mpfr_set_si(results[i], 0, SYNGE_ROUND);
+			errors[i] = to_error_code(INVALID_LEFT_OPERAND, -1);
+		}
+		return;
+	}
+
+	/* one thread per core by default, but never more threads than points */
+	if(threads < 1)
+		threads = get_cores();
+
+	if(threads > count)
+		threads = count;
+
+	if(threads < 1)
+		return;
+
+	struct tab_job job = {
+		.base = ctx,
+		.expression = expression,
+		.variable = variable,
+		.results = results,
+		.errors = errors,
+		.count = count,
+		.threads = threads
+	};
+
+	/* the points are evenly spaced from one end of the range to the other (inclusive) */
+	mpfr_inits2(SYNGE_PRECISION, job.from, job.step, NULL);
+	mpfr_set(job.from, from, SYNGE_ROUND);
+	mpfr_sub(job.step, to, from, SYNGE_ROUND);
+
+	if(count > 1)
+		mpfr_div_si(job.step, job.step, count - 1, SYNGE_ROUND);
+
+	/* each worker starts with an even share of the points, and its own copy of the context with the variable bound */
+	job.ranges = malloc(threads * sizeof(struct tab_range));
+	struct tab_worker *workers = malloc(threads * sizeof(struct tab_worker));
+
+	int keylen = strlen(variable) + 1;
+	for(i = 0; i < threads; i++) {
+		job.ranges[i].next = (long) count * i / threads;
+		job.ranges[i].end = (long) count * (i + 1) / threads;
+		pthread_mutex_init(&job.ranges[i].lock, NULL);
+
+		workers[i].job = &job;
+		workers[i].id = i;
+		workers[i].ctx = synge_ctx_dup(ctx);
+		gmp_randseed_ui(workers[i].ctx->random.state, gmp_urandomb_ui(ctx->random.state, 32));
+
+		/* the variable replaces any function of the same name */
+		struct synge_ctx *wctx = workers[i].ctx;
+		ohm_remove(wctx->expression_list, variable, keylen);
+
+		if(!ohm_search(wctx->variable_list, variable, keylen)) {
+			synge_t value;
+			mpfr_init2(value, SYNGE_PRECISION);
+			ohm_insert(wctx->variable_list, variable, keylen, value, sizeof(synge_t));
+		}
+	}
+
+	/* the calling thread is the first worker */
+	for(i = 1; i < threads; i++)
+		if(pthread_create(&workers[i].thread, NULL, tab_thread, &workers[i]))
+			break;
+
+	/* the points of threads which couldn't be started are stolen by the others */
+	int started = i;
+
+	tab_run(&workers[0]);
+
+	for(i = 1; i < started; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	for(i = 0; i < threads; i++) {
+		synge_ctx_free(workers[i].ctx);
+		pthread_mutex_destroy(&job.ranges[i].lock);
+	}
+
+	free(workers);
+	free(job.ranges);
+	mpfr_clears(job.from, job.step, NULL);
+} /* synge_ctx_tabulate() */
+
+void synge_tabulate(char *expression, char *variable, synge_t from, synge_t to, int count, synge_t *results, struct synge_err *errors, int threads) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_tabulate(default_ctx, expression, variable, from, to, count, results, errors, threads);
+} /* synge_tabulate() */
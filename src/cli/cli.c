@@ -166,7 +166,7 @@ void cli_print_list(char *s) {
 		i = ohm_iter_init(vars);
 		for(; i.key; ohm_iter_inc(&i)) {
 			synge_t *num = i.value;
-			synge_printf("%s%*s - %.*" SYNGE_FORMAT "%s\n", ANSI_INFO, longest, (char *) i.key, synge_get_precision(*num), *num, ANSI_CLEAR);
+			printf("%s%*s - %s%s\n", ANSI_INFO, longest, (char *) i.key, synge_number_str(*num), ANSI_CLEAR);
 		}
 	}
 	else {
@@ -238,12 +238,28 @@ void cli_print_settings(char *s) {
 				break;
 		}
 	}
+	else if(!strcmp(args, "arithmetic")) {
+		switch(current_settings.arithmetic) {
+			case approximate:
+				ret = "Approximate";
+				break;
+			case exact:
+				ret = "Exact";
+				break;
+		}
+	}
 	else if(!strcmp(args, "precision")) {
 		if(current_settings.precision >= 0)
 			tmpfree = ret = itoa(current_settings.precision);
 		else
 			ret = "Dynamic";
 	}
+	else if(!strcmp(args, "depth"))
+		tmpfree = ret = itoa(current_settings.depth);
+	else if(!strcmp(args, "tails"))
+		tmpfree = ret = itoa(current_settings.tails);
+	else if(!strcmp(args, "timeout"))
+		tmpfree = ret = itoa(current_settings.timeout);
 
 	if(!ret)
 		printf("%s%s%s%s\n", ERROR_PADDING, ANSI_ERROR, synge_error_msg_pos(UNKNOWN_TOKEN, -1), ANSI_CLEAR);
@@ -294,6 +310,13 @@ void cli_set_settings(char *s) {
 			new_settings.strict = strict;
 		else err = true;
 	}
+	else if(!strncmp(args, "arithmetic ", strlen("arithmetic "))) {
+		if(!strcasecmp(val, "approximate"))
+			new_settings.arithmetic = approximate;
+		else if(!strcasecmp(val, "exact"))
+			new_settings.arithmetic = exact;
+		else err = true;
+	}
 	else if(!strncmp(args, "precision ", strlen("precision "))) {
 		errno = 0;
 
@@ -305,6 +328,27 @@ void cli_set_settings(char *s) {
 		if(errno)
 			err = true;
 	}
+	else if(!strncmp(args, "depth ", strlen("depth "))) {
+		errno = 0;
+		new_settings.depth = strtol(val, NULL, 10);
+
+		if(errno)
+			err = true;
+	}
+	else if(!strncmp(args, "tails ", strlen("tails "))) {
+		errno = 0;
+		new_settings.tails = strtol(val, NULL, 10);
+
+		if(errno)
+			err = true;
+	}
+	else if(!strncmp(args, "timeout ", strlen("timeout "))) {
+		errno = 0;
+		new_settings.timeout = strtol(val, NULL, 10);
+
+		if(errno)
+			err = true;
+	}
 	else err = true;
 
 	if(err)
@@ -510,7 +554,7 @@ int main(int argc, char **argv) {
 						printf("%s%s%s%s\n", ERROR_PADDING, synge_is_success_code(ecode.code) ? ANSI_GOOD : ANSI_ERROR, synge_error_msg(ecode), ANSI_CLEAR);
 				} else {
 					/* otherwise, print the result of the computation*/
-					synge_printf("%s%s%.*" SYNGE_FORMAT "%s\n", OUTPUT_PADDING, ANSI_OUTPUT, synge_get_precision(result), result, ANSI_CLEAR);
+					printf("%s%s%s%s\n", OUTPUT_PADDING, ANSI_OUTPUT, synge_number_str(result), ANSI_CLEAR);
 				}
 			}
 
@@ -35,18 +35,30 @@ void _print_stack(char *fname, struct stack *s) {
 	for(i = 0; i < size; i++) {
 		struct stack_cont tmp = s->content[i];
 
-		if(!tmp.val)
-			continue;
-
-		switch(tmp.tp) {
-			case number:
-				synge_fprintf(stderr, "%.*" SYNGE_FORMAT " ", synge_get_precision(SYNGE_T(tmp.val)), SYNGE_T(tmp.val));
+		switch(tmp.tag) {
+			case tag_number:
+				synge_fprintf(stderr, "%.*" SYNGE_FORMAT " ", synge_get_precision(tmp.val.num), tmp.val.num);
+				break;
+			case tag_integer:
+				fprintf(stderr, "%ld ", tmp.val.integer);
+				break;
+			case tag_bigint:
+				synge_fprintf(stderr, "%Zd ", tmp.val.bigint);
+				break;
+			case tag_rational:
+				synge_fprintf(stderr, "%Qd ", tmp.val.rational);
 				break;
-			case func:
-				fprintf(stderr, "%s ", FUNCTION(tmp.val)->name);
+			case tag_func:
+				fprintf(stderr, "%s ", tmp.val.func->name);
+				break;
+			case tag_op:
+				fprintf(stderr, "'%s' ", get_op_str(tmp.val.op));
+				break;
+			case tag_string:
+			case tag_span:
+				fprintf(stderr, "'%s' ", tmp.val.str);
 				break;
 			default:
-				fprintf(stderr, "'%s' ", (char *) tmp.val);
 				break;
 		}
 	}
@@ -74,26 +86,12 @@ void cheeky(char *format, ...) {
 #endif /* SYNGE_CHEEKY */
 } /* cheeky() */
 
-synge_t *num_dup(synge_t num) {
-	synge_t *ret = malloc(sizeof(synge_t));
-
-	mpfr_init2(*ret, SYNGE_PRECISION);
-	mpfr_set(*ret, num, SYNGE_ROUND);
-
-	return ret;
-} /* num_dup() */
-
 char *str_dup(char *s) {
 	char *ret = malloc(strlen(s) + 1);
 	memcpy(ret, s, strlen(s) + 1);
 	return ret;
 } /* str_dup() */
 
-void synge_clear(void *tofree) {
-	synge_t *item = tofree;
-	mpfr_clear(SYNGE_T(item));
-} /* synge_clear() */
-
 struct synge_op get_op(char *ch) {
 	int i;
 	struct synge_op ret = {NULL, op_none};
@@ -105,6 +103,15 @@ struct synge_op get_op(char *ch) {
 	return ret;
 } /* get_op() */
 
+char *get_op_str(int op) {
+	int i;
+	for(i = 0; op_list[i].str != NULL; i++)
+		if((int) op_list[i].tp == op)
+			return op_list[i].str;
+
+	return NULL;
+} /* get_op_str() */
+
 struct synge_const get_special_num(char *s) {
 	struct synge_const ret = {NULL, NULL, NULL};
 	int i;
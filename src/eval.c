@@ -22,6 +22,7 @@
 #include <ctype.h>
 #include <string.h>
 #include <strings.h>
+#include <limits.h>
 
 #include "synge.h"
 #include "version.h"
@@ -31,21 +32,244 @@
 #include "ohmic.h"
 #include "linked.h"
 
-/* greedy finder */
-static char *get_from_ch_list(char *ch, char **list) {
-	char *ret = NULL;
+/* memory used by a number on an evaluation stack */
+#define NUMBER_SIZE (sizeof(struct stack_cont) + mpfr_custom_get_size(SYNGE_PRECISION))
 
+/* word types */
+enum {
+	tp_var,
+	tp_func,
+	tp_none
+};
+
+/* the state of a word before it was first changed in a frame */
+struct journal_entry {
+	char *name;
+	int type;
+
+	synge_t var;
+	char *func;
+	bool hidden; /* whether the word was hiding a base word */
+
+	int prev; /* previous entry for the same word (or -1) */
+};
+
+struct eval_journal {
+	struct journal_entry *entries;
+	int length;
+	int size;
+
+	struct ohm_t *latest; /* index of the latest entry for each word */
+};
+
+/* a single level of evaluation (the main expression, a user function or a conditional) */
+struct eval_frame {
+	struct stack *rpn;
+	struct stack *evalstack;
+	int index; /* next instruction to evaluate */
+	int depth; /* number of calls deep (not counting tail calls) */
+
+	char *expression; /* stripped expression to save as SYNGE_PREV_EXPRESSION (or NULL) */
+	int trace; /* traceback level */
+	int chain; /* traceback level of the first frame this one replaced with tail calls (or its own level) */
+	int tails; /* number of tail calls since that frame */
+	int journal; /* journal length when the frame was entered */
+
+	/* instruction waiting on a word or called frame */
+	int call;
+	char *word;
+	int callpos;
+};
+
+struct eval_state {
+	struct synge_ctx *ctx;
+
+	struct eval_frame *frames;
+	int length;
+	int size;
+
+	struct eval_journal journal;
+	int ticks; /* instructions left until the next check for an interruption */
+
+	/* result and operand registers */
+	synge_t result, arg[3];
+
+	/* conversions between the context's angles and radians (worked out when first needed) */
+	bool angles;
+	synge_t to_rad, from_rad;
+};
+
+/* count memory towards the evaluation's budget */
+static void charge(struct eval_state *state, size_t bytes) {
+	state->ctx->watch.used.memory += bytes;
+} /* charge() */
+
+/* the context's scratch arguments, with room for at least the given number */
+static mpfr_ptr *scratch_args(struct synge_ctx *ctx, int count) {
+	struct synge_scratch *scratch = &ctx->scratch;
+
+	if(count > scratch->size) {
+		int i, size = count > scratch->size * 2 ? count : scratch->size * 2;
+
+		scratch->values = realloc(scratch->values, size * sizeof(synge_t));
+		scratch->args = realloc(scratch->args, size * sizeof(mpfr_ptr));
+
+		for(i = scratch->size; i < size; i++)
+			mpfr_init2(scratch->values[i], SYNGE_PRECISION);
+
+		/* the values may have moved */
+		for(i = 0; i < size; i++)
+			scratch->args[i] = scratch->values[i];
+
+		scratch->size = size;
+	}
+
+	return scratch->args;
+} /* scratch_args() */
+
+/* push a copy of a number onto an evaluation stack */
+static void push_number(struct eval_state *state, synge_t num, int pos, struct stack *s) {
+	charge(state, NUMBER_SIZE);
+	push_numstack(num, number, pos, s);
+} /* push_number() */
+
+/* push a small integer onto an evaluation stack (it costs the same as any other number, so budgets don't depend on
+ * how numbers are stored) */
+static void push_integer(struct eval_state *state, long num, int pos, struct stack *s) {
+	charge(state, NUMBER_SIZE);
+	push_intstack(num, number, pos, s);
+} /* push_integer() */
+
+/* push an exact integer onto an evaluation stack (large integers are charged for their limbs) */
+static void push_bigint(struct eval_state *state, mpz_t num, int pos, struct stack *s) {
+	size_t size = sizeof(struct stack_cont) + mpz_size(num) * sizeof(mp_limb_t);
+	charge(state, size > NUMBER_SIZE ? size : NUMBER_SIZE);
+	push_bigstack(num, number, pos, s);
+} /* push_bigint() */
+
+/* push an exact fraction onto an evaluation stack (charged for its limbs, like large integers) */
+static void push_rational(struct eval_state *state, mpq_t num, int pos, struct stack *s) {
+	size_t size = sizeof(struct stack_cont) + (mpz_size(mpq_numref(num)) + mpz_size(mpq_denref(num))) * sizeof(mp_limb_t);
+	charge(state, size > NUMBER_SIZE ? size : NUMBER_SIZE);
+	push_ratstack(num, number, pos, s);
+} /* push_rational() */
+
+/* the context's own words (and deleted base words) shadow the base layer */
+static bool in_overlay(struct synge_ctx *ctx, char *s, int len) {
+	return !ctx->base || ohm_search(ctx->variable_list, s, len) ||
+		ohm_search(ctx->expression_list, s, len) || ohm_search(ctx->hidden_list, s, len);
+} /* in_overlay() */
+
+synge_t *get_variable(struct synge_ctx *ctx, char *s) {
+	int len = strlen(s) + 1;
+	return ohm_search(in_overlay(ctx, s, len) ? ctx->variable_list : ctx->base->variable_list, s, len);
+} /* get_variable() */
+
+char *get_function(struct synge_ctx *ctx, char *s) {
+	int len = strlen(s) + 1;
+	return ohm_search(in_overlay(ctx, s, len) ? ctx->expression_list : ctx->base->expression_list, s, len);
+} /* get_function() */
+
+/* remove a word from whichever of the context's own lists it is in */
+static void drop_word(struct synge_ctx *ctx, char *s) {
+	synge_t *tmp = ohm_search(ctx->variable_list, s, strlen(s) + 1);
+
+	if(tmp) {
+		mpfr_clear(*tmp);
+		ohm_remove(ctx->variable_list, s, strlen(s) + 1);
+	}
+
+	ohm_remove(ctx->expression_list, s, strlen(s) + 1);
+} /* drop_word() */
+
+/* save the current state of a word, so it can be restored if the current frame fails */
+static void journal_record(struct eval_state *state, char *s) {
+	struct synge_ctx *ctx = state->ctx;
+	struct eval_journal *journal = &state->journal;
+	int *latest = ohm_search(journal->latest, s, strlen(s) + 1);
+
+	/* only the first change to a word in a frame needs to be saved */
+	if(latest && *latest >= state->frames[state->length - 1].journal)
+		return;
+
+	if(journal->length >= journal->size) {
+		journal->size = journal->size ? journal->size * 2 : 16;
+		journal->entries = realloc(journal->entries, journal->size * sizeof(struct journal_entry));
+	}
+
+	int index = journal->length++;
+	struct journal_entry *entry = &journal->entries[index];
+
+	entry->name = str_dup(s);
+	entry->prev = latest ? *latest : -1;
+	entry->func = NULL;
+	entry->type = tp_none;
+	entry->hidden = ohm_search(ctx->hidden_list, s, strlen(s) + 1) != NULL;
+
+	if(ohm_search(ctx->variable_list, s, strlen(s) + 1)) {
+		entry->type = tp_var;
+		mpfr_init2(entry->var, SYNGE_PRECISION);
+		mpfr_set(entry->var, *(synge_t *) ohm_search(ctx->variable_list, s, strlen(s) + 1), SYNGE_ROUND);
+	} else if(ohm_search(ctx->expression_list, s, strlen(s) + 1)) {
+		entry->type = tp_func;
+		entry->func = str_dup(ohm_search(ctx->expression_list, s, strlen(s) + 1));
+	}
+
+	ohm_insert(journal->latest, s, strlen(s) + 1, &index, sizeof(int));
+} /* journal_record() */
+
+/* restore every word changed since the journal was the given length */
+static void journal_rollback(struct eval_state *state, int length) {
+	struct synge_ctx *ctx = state->ctx;
+	struct eval_journal *journal = &state->journal;
+
+	while(journal->length > length) {
+		struct journal_entry *entry = &journal->entries[--journal->length];
+
+		/* revert word to its old state (the entry's values are moved back into the lists) */
+		drop_word(state->ctx, entry->name);
+
+		switch(entry->type) {
+			case tp_var:
+				ohm_insert(ctx->variable_list, entry->name, strlen(entry->name) + 1, entry->var, sizeof(synge_t));
+				break;
+			case tp_func:
+				ohm_insert(ctx->expression_list, entry->name, strlen(entry->name) + 1, entry->func, strlen(entry->func) + 1);
+				break;
+		}
+
+		if(entry->hidden)
+			ohm_insert(ctx->hidden_list, entry->name, strlen(entry->name) + 1, "", 1);
+		else
+			ohm_remove(ctx->hidden_list, entry->name, strlen(entry->name) + 1);
+
+		if(entry->prev < 0)
+			ohm_remove(journal->latest, entry->name, strlen(entry->name) + 1);
+		else
+			ohm_insert(journal->latest, entry->name, strlen(entry->name) + 1, &entry->prev, sizeof(int));
+
+		free(entry->func);
+		free(entry->name);
+	}
+} /* journal_rollback() */
+
+/* forget all saved states, keeping every change */
+static void journal_free(struct eval_journal *journal) {
 	int i;
-	for(i = 0; list[i] != NULL; i++)
-		/* checks against part or entire string against the given list */
-		if((!ret || strlen(ret) < strlen(list[i])) && !strcmp(list[i], ch))
-			ret = list[i];
+	for(i = 0; i < journal->length; i++) {
+		if(journal->entries[i].type == tp_var)
+			mpfr_clear(journal->entries[i].var);
+
+		free(journal->entries[i].func);
+		free(journal->entries[i].name);
+	}
 
-	return ret;
-} /* get_from_ch_list() */
+	free(journal->entries);
+	ohm_free(journal->latest);
+} /* journal_free() */
 
-static struct synge_err set_variable(char *str, synge_t val) {
-	assert(synge_started == true, "synge must be initialised");
+static struct synge_err set_variable(struct eval_state *state, char *str, synge_t val) {
+	struct synge_ctx *ctx = state->ctx;
 	char *endptr = NULL, *s = get_word(str, SYNGE_WORD_CHARS, &endptr);
 
 	/* SYNGE_PREV_EXPRESSION is immutable */
@@ -54,27 +278,30 @@ static struct synge_err set_variable(char *str, synge_t val) {
 		return to_error_code(INVALID_LEFT_OPERAND, -1);
 	}
 
+	journal_record(state, s);
+
 	/* make a new copy of the variable to save */
 	synge_t tosave;
 	mpfr_init2(tosave, SYNGE_PRECISION);
 	mpfr_set(tosave, val, SYNGE_ROUND);
 
 	/* free old value (if there is one) */
-	if(ohm_search(variable_list, s, strlen(s) + 1)) {
-		synge_t *tmp = ohm_search(variable_list, s, strlen(s) + 1);
+	if(ohm_search(ctx->variable_list, s, strlen(s) + 1)) {
+		synge_t *tmp = ohm_search(ctx->variable_list, s, strlen(s) + 1);
 		mpfr_clear(*tmp);
 	}
 
 	/* save the variable */
-	ohm_remove(expression_list, s, strlen(s) + 1); /* remove word from function list (fake dynamic typing) */
-	ohm_insert(variable_list, s, strlen(s) + 1, tosave, sizeof(synge_t));
+	charge(state, strlen(s) + 1 + sizeof(synge_t) + mpfr_custom_get_size(SYNGE_PRECISION));
+	ohm_remove(ctx->expression_list, s, strlen(s) + 1); /* remove word from function list (fake dynamic typing) */
+	ohm_insert(ctx->variable_list, s, strlen(s) + 1, tosave, sizeof(synge_t));
 
 	free(s);
 	return to_error_code(SUCCESS, -1);
 } /* set_variable() */
 
-static struct synge_err set_function(char *str, char *exp) {
-	assert(synge_started == true, "synge must be initialised");
+static struct synge_err set_function(struct eval_state *state, char *str, char *exp) {
+	struct synge_ctx *ctx = state->ctx;
 	char *endptr = NULL, *s = get_word(str, SYNGE_WORD_CHARS, &endptr);
 
 	/* SYNGE_PREV_EXPRESSION is immutable */
@@ -83,1067 +310,1473 @@ static struct synge_err set_function(char *str, char *exp) {
 		return to_error_code(INVALID_LEFT_OPERAND, -1);
 	}
 
+	journal_record(state, s);
+
 	/* save the function */
-	ohm_remove(variable_list, s, strlen(s) + 1); /* remove word from variable list (fake dynamic typing) */
-	ohm_insert(expression_list, s, strlen(s) + 1, exp, strlen(exp) + 1);
+	charge(state, strlen(s) + 1 + strlen(exp) + 1);
+	drop_word(ctx, s); /* remove word from variable list (fake dynamic typing) */
+	ohm_insert(ctx->expression_list, s, strlen(s) + 1, exp, strlen(exp) + 1);
 
 	free(s);
 	return to_error_code(SUCCESS, -1);
 } /* set_function() */
 
-static struct synge_err del_word(char *s, int pos) {
-	assert(synge_started == true, "synge must be initialised");
+static struct synge_err del_word(struct eval_state *state, char *s, int pos) {
+	struct synge_ctx *ctx = state->ctx;
 
-	/* word types */
-	enum {
-		tp_var,
-		tp_func,
-		tp_none
-	};
-
-	int type = tp_none;
-
-	/* get type of word */
-	if(ohm_search(variable_list, s, strlen(s) + 1))
-		type = tp_var;
-	else if(ohm_search(expression_list, s, strlen(s) + 1))
-		type = tp_func;
-	else
+	/* word must exist */
+	if(!get_variable(ctx, s) && !get_function(ctx, s))
 		return to_error_code(UNKNOWN_WORD, pos);
 
+	journal_record(state, s);
+
 	/* free from correct list */
-	switch(type) {
-		case tp_var:
-			{
-				/* free mpfr_t */
-				synge_t *tmp = ohm_search(variable_list, s, strlen(s) + 1);
-				mpfr_clear(*tmp);
+	drop_word(ctx, s);
 
-				/* free entry */
-				ohm_remove(variable_list, s, strlen(s) + 1);
-			}
-			break;
-		case tp_func:
-			/* free entry */
-			ohm_remove(expression_list, s, strlen(s) + 1);
-			break;
-		default:
-			return to_error_code(UNKNOWN_WORD, pos);
-			break;
-	}
+	/* the base layer can't be changed, so its word is hidden instead */
+	if(ctx->base && (ohm_search(ctx->base->variable_list, s, strlen(s) + 1) || ohm_search(ctx->base->expression_list, s, strlen(s) + 1)))
+		ohm_insert(ctx->hidden_list, s, strlen(s) + 1, "", 1);
 
 	return to_error_code(SUCCESS, -1);
 } /* del_word() */
 
-/* functions' whose input needs to be in radians */
-static char *angle_infunc_list[] = {
-	"sin",
-	"cos",
-	"tan",
-	NULL
-};
+/* work out the conversions between the context's angles and radians (the same way as deg_to_rad() and friends) */
+static void angle_factors(struct eval_state *state) {
+	if(state->angles)
+		return;
+
+	long half = state->ctx->settings.mode == gradians ? 200 : 180;
+
+	mpfr_const_pi(state->to_rad, SYNGE_ROUND);
+	mpfr_si_div(state->from_rad, half, state->to_rad, SYNGE_ROUND);
+	mpfr_div_si(state->to_rad, state->to_rad, half, SYNGE_ROUND);
+
+	state->angles = true;
+} /* angle_factors() */
 
 /* convert from set mode to radians */
-static void settings_to_rad(synge_t out, synge_t in) {
-	switch(active_settings.mode) {
-		case degrees:
-			deg_to_rad(out, in, SYNGE_ROUND);
-			break;
-		case gradians:
-			grad_to_rad(out, in, SYNGE_ROUND);
-			break;
-		case radians:
-			mpfr_set(out, in, SYNGE_ROUND);
-			break;
+static void settings_to_rad(struct eval_state *state, synge_t out, synge_t in) {
+	if(state->ctx->settings.mode == radians) {
+		mpfr_set(out, in, SYNGE_ROUND);
+		return;
 	}
-} /* settings_to_rad() */
 
-/* functions' whose output is in radians */
-static char *angle_outfunc_list[] = {
-	"asin",
-	"acos",
-	"atan",
-	NULL
-};
+	angle_factors(state);
+	mpfr_mul(out, in, state->to_rad, SYNGE_ROUND);
+} /* settings_to_rad() */
 
 /* convert radians to set mode */
-static void rad_to_settings(synge_t out, synge_t in) {
-	switch(active_settings.mode) {
-		case degrees:
-			rad_to_deg(out, in, SYNGE_ROUND);
-			break;
-		case gradians:
-			rad_to_grad(out, in, SYNGE_ROUND);
-			break;
-		case radians:
-			mpfr_set(out, in, SYNGE_ROUND);
-			break;
+static void rad_to_settings(struct eval_state *state, synge_t out, synge_t in) {
+	if(state->ctx->settings.mode == radians) {
+		mpfr_set(out, in, SYNGE_ROUND);
+		return;
 	}
+
+	angle_factors(state);
+	mpfr_mul(out, in, state->from_rad, SYNGE_ROUND);
 } /* rad_to_settings() */
 
-static struct synge_err eval_word(char *str, int pos, synge_t *result) {
-	if(ohm_search(variable_list, str, strlen(str) + 1)) {
-		synge_t *value = ohm_search(variable_list, str, strlen(str) + 1);
-		mpfr_set(*result, *value, SYNGE_ROUND);
-	} else if(ohm_search(expression_list, str, strlen(str) + 1)) {
-		/* recursively evaluate a user function's value */
-		char *expression = ohm_search(expression_list, str, strlen(str) + 1);
-		struct synge_err tmpecode = synge_internal_compute_string(expression, result, str, pos);
-
-		/* error was encountered */
-		if(!synge_is_success_code(tmpecode.code)) {
-			if(active_settings.error == traceback)
-				/* return real error code for traceback */
-				return tmpecode;
-			else
-				/* return relative error code for all other error formats */
-				return to_error_code(tmpecode.code, pos);
-		}
-	} else {
-		/* unknown variable or function */
-		return to_error_code(UNKNOWN_TOKEN, pos);
+/* the expression '_' becomes once it has been evaluated successfully (or NULL if it refers to '_' itself) */
+char *answer_expression(char *string) {
+	char *expression = trim_spaces(string);
+
+	if(expression && contains_word(expression, SYNGE_PREV_EXPRESSION, SYNGE_WORD_CHARS)) {
+		free(expression);
+		return NULL;
 	}
 
-	/* is the result a nan? */
-	if(mpfr_nan_p(*result))
-		return to_error_code(UNDEFINED, pos);
+	return expression;
+} /* answer_expression() */
 
-	return to_error_code(SUCCESS, -1);
-} /* eval_word() */
+/* whether setting '_' to the given expression would change it */
+bool answer_changes(struct synge_ctx *ctx, char *expression) {
+	if(!expression)
+		return false;
 
-static struct synge_err eval_expression(char *exp, char *caller, int pos, synge_t *result) {
-	struct synge_err ret = synge_internal_compute_string(exp, result, caller, pos);
+	char *prev = ohm_search(ctx->expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1);
+	return !prev || strcmp(prev, expression);
+} /* answer_changes() */
 
-	/* error was encountered */
-	if(!synge_is_success_code(ret.code)) {
-		if(active_settings.error == traceback)
-			/* return real error code for traceback */
-			return ret;
-		else
-			/* return relative error code for all other error formats */
-			return to_error_code(ret.code, pos);
-	}
+/* save the answer of a successful evaluation, and set '_' to its expression (if it has one) */
+void set_answer(struct synge_ctx *ctx, char *expression, synge_t result) {
+	mpfr_set(ctx->prev_answer, result, SYNGE_ROUND);
 
-	return to_error_code(SUCCESS, -1);
-}
+	if(answer_changes(ctx, expression))
+		ohm_insert(ctx->expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1, expression, strlen(expression) + 1);
+} /* set_answer() */
 
-/* evaluate an rpn stack */
-struct synge_err synge_eval_rpnstack(struct stack **rpn, synge_t *output) {
-	struct stack *evalstack = malloc(sizeof(struct stack));
-	init_stack(evalstack);
+/* start evaluating an expression in a new frame */
+static struct synge_err eval_push(struct eval_state *state, char *string, char *caller, int position) {
+	struct synge_ctx *ctx = state->ctx;
 
-	_debug("--\nEvaluator\n--\n");
+	if(state->length >= state->size) {
+		state->size = state->size ? state->size * 2 : 16;
+		state->frames = realloc(state->frames, state->size * sizeof(struct eval_frame));
+	}
 
-	int i, tmp = 0, size = stack_size(*rpn);
-	synge_t *result = NULL, arg[3];
-	struct synge_err ecode[2];
+	struct eval_frame *frame = &state->frames[state->length++];
 
-	/* initialise operators */
-	mpfr_inits2(SYNGE_PRECISION, arg[0], arg[1], arg[2], NULL);
+	frame->rpn = malloc(sizeof(struct stack));
+	frame->evalstack = malloc(sizeof(struct stack));
+	init_stack(frame->rpn);
+	init_stack(frame->evalstack);
 
-	for(i = 0; i < size; i++) {
-		/* shorthand variables */
-		struct stack_cont stackp = (*rpn)->content[i];
-		int pos = stackp.position;
-		tmp = 0;
+	frame->index = 0;
+	frame->depth = state->length > 1 ? state->frames[state->length - 2].depth + 1 : 0;
+	frame->call = -1;
+	frame->word = NULL;
+	frame->callpos = -1;
 
-		/* debugging */
-		switch(stackp.tp) {
-			case number:
-				debug("%" SYNGE_FORMAT "\n", SYNGE_T(stackp.val));
-				break;
-			case func:
-				debug("%s\n", FUNCTION(stackp.val)->name);
-				break;
-			default:
-				debug("%s\n", stackp.val);
-				break;
-		}
+	/* add level to traceback and mark the point to roll back to */
+	frame->trace = trace_push(ctx, caller, position);
+	frame->chain = frame->trace;
+	frame->tails = 0;
+	frame->journal = state->journal.length;
 
-		print_stack(evalstack);
+	frame->expression = answer_expression(string);
 
-		switch(stackp.tp) {
-			case number:
-			case constant:
-				/* just push it onto the final stack */
-				push_valstack(num_dup(SYNGE_T(stackp.val)), number, true, synge_clear, pos, evalstack);
-				break;
-			case expression:
-			case setword:
-				/* just push it onto the final stack */
-				push_valstack(str_dup(stackp.val), stackp.tp, true, NULL, pos, evalstack);
-				break;
-			case setop:
-				{
-					if(stack_size(evalstack) < 2) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(OPERATOR_WRONG_ARGC, pos);
-					}
+	debug("depth %d with caller %s\n", frame->depth, caller);
+	debug("expression '%s'\n", string);
 
-					char *tmpexp = NULL;
-
-					/* get new value for word */
-					if(top_stack(evalstack)->tp == number) {
-						/* variable value */
-						mpfr_set(arg[0], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
-					} else if(top_stack(evalstack)->tp == expression) {
-						/* function expression value */
-						tmpexp = str_dup(top_stack(evalstack)->val);
-					} else {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+	struct stack *infix_stack = malloc(sizeof(struct stack));
+	init_stack(infix_stack);
 
-					free_stack_cont(pop_stack(evalstack));
+	/* generate infix stack */
+	struct synge_err ecode = synge_lex_string(ctx, string, &infix_stack);
 
-					/* get word */
-					if(top_stack(evalstack)->tp != setword) {
-						free(tmpexp);
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+	/* convert to postfix (or RPN) stack */
+	if(ecode.code == SUCCESS)
+		ecode = synge_infix_parse(ctx, &infix_stack, &frame->rpn);
 
-					char *tmpstr = str_dup(top_stack(evalstack)->val);
-					free_stack_cont(pop_stack(evalstack));
+	free_stackm(&infix_stack);
 
-					/* set variable or function */
-					switch(get_op(stackp.val).tp) {
-						case op_var_set:
-							ecode[0] = set_variable(tmpstr, arg[0]);
-							break;
-						case op_func_set:
-							ecode[0] = set_function(tmpstr, tmpexp);
-							break;
-						default:
-							ecode[0] = to_error_code(UNKNOWN_ERROR, pos);
-							break;
-					}
+	/* the expression and its parsed instructions count towards the evaluation's memory */
+	charge(state, strlen(string) + 1);
 
-					/* check if an error occured in the definitions */
-					if(!synge_is_success_code(ecode[0].code)) {
-						free(tmpstr);
-						free(tmpexp);
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(ecode[0].code, pos);
-					}
+	int i;
+	for(i = 0; ecode.code == SUCCESS && i < stack_size(frame->rpn); i++) {
+		struct stack_cont *instruction = &frame->rpn->content[i];
 
-					free(tmpexp);
+		if(instruction->tag == tag_number || instruction->tag == tag_integer || instruction->tag == tag_bigint || instruction->tag == tag_rational)
+			charge(state, NUMBER_SIZE);
+		else if(instruction->tag == tag_string)
+			charge(state, sizeof(struct stack_cont) + strlen(instruction->val.str) + 1);
+		else
+			charge(state, sizeof(struct stack_cont));
+	}
 
-					/* evaulate and push the value of set word */
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
+	_debug("--\nEvaluator\n--\n");
+	return ecode;
+} /* eval_push() */
 
-					ecode[0] = eval_word(tmpstr, pos, result);
-					if(!synge_is_success_code(ecode[0].code)) {
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free(tmpstr);
-						free_stackm(&evalstack, rpn);
+/* finish the top frame, leaving its result in the result register */
+static struct synge_err eval_pop(struct eval_state *state, struct synge_err ecode) {
+	struct synge_ctx *ctx = state->ctx;
+	struct eval_frame *frame = &state->frames[state->length - 1];
 
-						/* when setting functions, we ignore any errors
-						 * and any errors with setting a variable would have already been reported */
-						return to_error_code(ERROR_FUNC_ASSIGNMENT, pos);
-					}
-					push_valstack(result, number, true, synge_clear, pos, evalstack);
-					free(tmpstr);
-				}
-				break;
-			case modop:
-				{
-					if(stack_size(evalstack) < 2) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(OPERATOR_WRONG_ARGC, pos);
-					}
+	/* if there is not one item on the stack, there are too many values on the stack */
+	if(synge_is_success_code(ecode.code) && stack_size(frame->evalstack) != 1)
+		ecode = to_error_code(TOO_MANY_VALUES, -1);
 
-					if(top_stack(evalstack)->tp != number) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_RIGHT_OPERAND, pos);
-					}
+	print_stack(frame->evalstack);
 
-					/* get value to modify variable by */
-					mpfr_set(arg[1], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
-					free_stack_cont(pop_stack(evalstack));
+	/* otherwise, the last item is the result */
+	if(synge_is_success_code(ecode.code))
+		get_numstack(&frame->evalstack->content[0], state->result);
+	else
+		mpfr_set_si(state->result, 0, SYNGE_ROUND);
+
+	/* fix up negative zeros */
+	if(iszero(state->result))
+		mpfr_abs(state->result, state->result, SYNGE_ROUND);
+
+	/* is it a nan? */
+	if(mpfr_nan_p(state->result))
+		ecode = to_error_code(UNDEFINED, -1);
+
+	/* if some error occured, revert variables and functions back to previous good state */
+	if(!synge_is_success_code(ecode.code) && !synge_is_ignore_code(ecode.code))
+		journal_rollback(state, frame->journal);
+
+	/* make sure user hasn't done something like set '_' to a variable or deleted it */
+	if(ohm_search(ctx->variable_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1) ||
+			!ohm_search(ctx->expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1)) {
+		journal_record(state, SYNGE_PREV_EXPRESSION);
+		drop_word(ctx, SYNGE_PREV_EXPRESSION);
+		ohm_insert(ctx->expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1, "", 1);
+	}
 
-					/* get variable to modify */
-					if(top_stack(evalstack)->tp != setword) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+	/* if everything went well, set the answer variable (and remove current depth from traceback) */
+	if(synge_is_success_code(ecode.code)) {
+		trace_truncate(ctx, frame->chain);
 
-					/* get variable name */
-					char *tmpstr = str_dup(top_stack(evalstack)->val);
-					free_stack_cont(pop_stack(evalstack));
+		if(answer_changes(ctx, frame->expression))
+			journal_record(state, SYNGE_PREV_EXPRESSION);
 
-					/* check if it really is a variable */
-					if(!ohm_search(variable_list, tmpstr, strlen(tmpstr) + 1)) {
-						free(tmpstr);
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+		set_answer(ctx, frame->expression, state->result);
+	}
 
-					/* get current value of variable */
-					mpfr_set(arg[0], SYNGE_T(ohm_search(variable_list, tmpstr, strlen(tmpstr) + 1)), SYNGE_ROUND);
-
-					/* evaluate changed variable */
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
-
-					switch(get_op(stackp.val).tp) {
-						case op_ca_add:
-							mpfr_add(*result, arg[0], arg[1], SYNGE_ROUND);
-							break;
-						case op_ca_subtract:
-							mpfr_sub(*result, arg[0], arg[1], SYNGE_ROUND);
-							break;
-						case op_ca_multiply:
-							mpfr_mul(*result, arg[0], arg[1], SYNGE_ROUND);
-							break;
-						case op_ca_int_divide:
-							/* division, but the result ignores the decimals */
-							tmp = 1;
-
-							/* fall-through */
-						case op_ca_divide:
-							if(iszero(arg[1])) {
-								/* the 11th commandment -- thoust shalt not divide by zero */
-								mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-								free(tmpstr);
-								free(result);
-								free_stackm(&evalstack, rpn);
-								return to_error_code(DIVIDE_BY_ZERO, pos);
-							}
+	/* the failing level stays in the traceback */
+	else
+		trace_keep(ctx, frame->trace);
+
+	/* free memory */
+	free(frame->expression);
+	free_stackm(&frame->rpn, &frame->evalstack);
+
+	state->length--;
+	return ecode;
+} /* eval_pop() */
+
+/* finish the instruction which was waiting on a word's value (given in the result register) */
+static struct synge_err eval_return(struct eval_state *state, struct eval_frame *frame, struct synge_err ecode) {
+	struct synge_ctx *ctx = state->ctx;
+	int pos = frame->callpos;
+
+	/* return relative error code for all error formats other than traceback */
+	if(!synge_is_success_code(ecode.code) && ctx->settings.error != traceback)
+		ecode = to_error_code(ecode.code, pos);
+
+	/* an interrupted evaluation can't be ignored, no matter what was waiting on it */
+	if(is_interrupt_code(ecode.code))
+		return ecode;
+
+	switch(frame->call) {
+		case setop:
+			/* when setting functions, we ignore any errors
+			 * and any errors with setting a variable would have already been reported */
+			if(!synge_is_success_code(ecode.code))
+				return to_error_code(ERROR_FUNC_ASSIGNMENT, pos);
+			break;
+		case delop:
+			{
+				/* delete word (even if evaluating it failed) */
+				struct synge_err delcode = del_word(state, frame->word, pos);
 
-							mpfr_div(*result, arg[0], arg[1], SYNGE_ROUND);
-
-							/* integer division? */
-							if(tmp)
-								mpfr_trunc(*result, *result);
-							break;
-						case op_ca_modulo:
-							if(iszero(arg[1])) {
-								/* the 11.5th commandment -- thoust shalt not modulo by zero */
-								mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-								free(tmpstr);
-								free(result);
-								free_stackm(&evalstack, rpn);
-								return to_error_code(MODULO_BY_ZERO, pos);
-							}
+				/* delete error check */
+				if(!synge_is_success_code(delcode.code))
+					return delcode;
 
-							mpfr_fmod(*result, arg[0], arg[1], SYNGE_ROUND);
-							break;
-						case op_ca_index:
-							mpfr_pow(*result, arg[0], arg[1], SYNGE_ROUND);
-							break;
-						case op_ca_band:
-							{
-								/* initialise gmp integer types */
-								mpz_t final, op1, op2;
-								mpz_init2(final, SYNGE_PRECISION);
-								mpz_init2(op1, SYNGE_PRECISION);
-								mpz_init2(op2, SYNGE_PRECISION);
+				/* eval error check */
+				if(!synge_is_success_code(ecode.code))
+					return to_error_code(ERROR_DELETE, pos);
+			}
+			break;
+		default:
+			if(!synge_is_success_code(ecode.code))
+				return ecode;
+			break;
+	}
 
-								/* copy over operators to gmp integers */
-								mpfr_get_z(op1, arg[0], SYNGE_ROUND);
-								mpfr_get_z(op2, arg[1], SYNGE_ROUND);
+	/* push result of evaluation onto the stack */
+	push_number(state, state->result, pos, frame->evalstack);
 
-								/* do binary and, and set result */
-								mpz_and(final, op1, op2);
-								mpfr_set_z(*result, final, SYNGE_ROUND);
+	frame->call = -1;
+	frame->word = NULL;
+	return to_error_code(SUCCESS, -1);
+} /* eval_return() */
+
+/* evaluate an expression in place of the top frame (a tail call) */
+static struct synge_err eval_replace(struct eval_state *state, int tp, char *string, char *caller, int position) {
+	struct synge_ctx *ctx = state->ctx;
+	struct eval_frame old = state->frames[--state->length];
+
+	/* the old frame's level stays in the traceback (its caller's name may be freed before an error is reported), but
+	 * the levels between the first and last frames of a long chain of tail calls are folded into one */
+	trace_keep(ctx, old.trace);
+	if(old.tails >= 2)
+		trace_elide(ctx, old.trace - 1);
+
+	/* the expression may live in the old frame's rpn stack, so it must be parsed first */
+	struct synge_err ecode = eval_push(state, string, caller, position);
+	struct eval_frame *frame = &state->frames[state->length - 1];
+
+	/* the caller's name is also borrowed from the old frame */
+	trace_keep(ctx, frame->trace);
+
+	/* tail calls run in constant space, so they don't count towards the depth (they have their own limit instead) */
+	frame->depth = old.depth;
+	frame->chain = old.chain;
+	frame->tails = old.tails + 1;
+
+	/* an error rolls back everything since the old frame was entered */
+	frame->journal = old.journal;
+
+	/* the outermost expression is the one saved as '_' */
+	if(old.expression) {
+		free(frame->expression);
+		frame->expression = old.expression;
+	}
 
-								/* clean up */
-								mpz_clears(final, op1, op2, NULL);
-							}
-							break;
-						case op_ca_bor:
-							{
-								/* initialise gmp integer types */
-								mpz_t final, op1, op2;
-								mpz_init2(final, SYNGE_PRECISION);
-								mpz_init2(op1, SYNGE_PRECISION);
-								mpz_init2(op2, SYNGE_PRECISION);
+	free_stackm(&old.rpn, &old.evalstack);
+	return ecode;
+} /* eval_replace() */
 
-								/* copy over operators to gmp integers */
-								mpfr_get_z(op1, arg[0], SYNGE_ROUND);
-								mpfr_get_z(op2, arg[1], SYNGE_ROUND);
+/* evaluate an expression in a new frame on behalf of the given instruction */
+static struct synge_err eval_call(struct eval_state *state, struct eval_frame *frame, int tp, char *exp, char *caller, int position, int pos) {
+	struct synge_ctx *ctx = state->ctx;
 
-								/* do binary or, and set result */
-								mpz_ior(final, op1, op2);
-								mpfr_set_z(*result, final, SYNGE_ROUND);
+	frame->call = tp;
+	frame->callpos = pos;
 
-								/* clean up */
-								mpz_clears(final, op1, op2, NULL);
-							}
-							break;
-						case op_ca_bxor:
-							{
-								/* initialise gmp integer types */
-								mpz_t final, op1, op2;
-								mpz_init2(final, SYNGE_PRECISION);
-								mpz_init2(op1, SYNGE_PRECISION);
-								mpz_init2(op2, SYNGE_PRECISION);
+	/* We have delved too greedily and too deeply.
+	 * We have awoken a creature in the darkness of recursion.
+	 * A creature of shadow, flame and infinite loops.
+	 * YOU SHALL NOT PASS! */
+	if(frame->depth >= ctx->settings.depth) {
+		cheeky("YOU SHALL NOT PASS!\n");
+		return eval_return(state, frame, to_error_code(TOO_DEEP, -1));
+	}
 
-								/* copy over operators to gmp integers */
-								mpfr_get_z(op1, arg[0], SYNGE_ROUND);
-								mpfr_get_z(op2, arg[1], SYNGE_ROUND);
+	/* user function calls (but not conditionals) count towards the evaluation's budget */
+	if(tp != elseop) {
+		struct synge_watch *watch = &ctx->watch;
 
-								/* do binary xor, and set result */
-								mpz_xor(final, op1, op2);
-								mpfr_set_z(*result, final, SYNGE_ROUND);
+		if(watch->limit.calls > 0 && watch->used.calls >= watch->limit.calls)
+			return eval_return(state, frame, to_error_code(CALL_LIMIT, -1));
 
-								/* clean up */
-								mpz_clears(final, op1, op2, NULL);
-							}
-							break;
-						case op_ca_bshiftl:
-							{
-								/* bitshifting is an integer operation */
-								mpfr_trunc(arg[1], arg[1]);
-								mpfr_trunc(arg[0], arg[0]);
-
-								/* x << y === x * 2^y */
-								mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
-								mpfr_mul(*result, arg[0], arg[1], SYNGE_ROUND);
-
-								/* again, integer operation */
-								mpfr_trunc(*result, *result);
-							}
-							break;
-						case op_ca_bshiftr:
-							{
-								/* bitshifting is an integer operation */
-								mpfr_trunc(arg[1], arg[1]);
-								mpfr_trunc(arg[0], arg[0]);
-
-								/* x >> y === x / 2^y */
-								mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
-								mpfr_div(*result, arg[0], arg[1], SYNGE_ROUND);
-
-								/* again, integer operation */
-								mpfr_trunc(*result, *result);
-							}
-							break;
-						default:
-							/* catch-all -- unknown token */
-							mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-							free(tmpstr);
-							free(result);
-							free_stackm(&evalstack, rpn);
-							return to_error_code(UNKNOWN_TOKEN, pos);
-							break;
-					}
+		watch->used.calls++;
+	}
 
-					/* set variable to new value */
-					set_variable(tmpstr, *result);
+	/* if the call is the last thing the frame does, its result would be the frame's result -- so just jump to it
+	 * (the main frame is kept, so errors are still reported relative to it) */
+	if((tp == userword || tp == elseop) && state->length > 1 &&
+			frame->index >= stack_size(frame->rpn) && !stack_size(frame->evalstack)) {
+		/* a chain of tail calls runs in constant space, but one which never ends is still too deep */
+		if(frame->tails >= ctx->settings.tails) {
+			cheeky("YOU SHALL NOT PASS!\n");
+			return eval_return(state, frame, to_error_code(TOO_DEEP, -1));
+		}
 
-					/* push new value of variable */
-					push_valstack(result, number, true, synge_clear, pos, evalstack);
-					free(tmpstr);
-				}
-				break;
-			case premod:
-				tmp = 1;
-				/* pass-through */
-			case postmod:
-				{
-					if(stack_size(evalstack) < 1) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(OPERATOR_WRONG_ARGC, pos);
-					}
+		return eval_replace(state, tp, exp, caller, position);
+	}
 
-					/* get variable to modify */
-					if(top_stack(evalstack)->tp != setword) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+	return eval_push(state, exp, caller, position);
+} /* eval_call() */
 
-					char *tmpstr = str_dup(top_stack(evalstack)->val);
-					free_stack_cont(pop_stack(evalstack));
+/* get the value of a word, calling it if it is a user function */
+static struct synge_err eval_word(struct eval_state *state, struct eval_frame *frame, int tp, char *str, int pos) {
+	struct synge_ctx *ctx = state->ctx;
 
-					/* check if it really is a variable */
-					if(!ohm_search(variable_list, tmpstr, strlen(tmpstr) + 1)) {
-						free(tmpstr);
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+	frame->call = tp;
+	frame->word = str;
+	frame->callpos = pos;
 
-					/* get current value of variable */
-					mpfr_set(arg[0], SYNGE_T(ohm_search(variable_list, tmpstr, strlen(tmpstr) + 1)), SYNGE_ROUND);
-
-					/* evaluate changed variable */
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
-
-					switch(get_op(stackp.val).tp) {
-						case op_ca_increment:
-							mpfr_add_si(*result, arg[0], 1, SYNGE_ROUND);
-							break;
-						case op_ca_decrement:
-							mpfr_sub_si(*result, arg[0], 1, SYNGE_ROUND);
-							break;
-						default:
-							/* catch-all -- unknown token */
-							mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-							free(tmpstr);
-							free(result);
-							free_stackm(&evalstack, rpn);
-							return to_error_code(UNKNOWN_TOKEN, pos);
-							break;
-					}
+	synge_t *value = get_variable(ctx, str);
+	char *exp = get_function(ctx, str);
 
-					/* set variable to new value */
-					set_variable(tmpstr, *result);
+	if(value) {
+		mpfr_set(state->result, *value, SYNGE_ROUND);
 
-					/* push value of variable (depending on pre/post) */
-					push_valstack(tmp ? result : num_dup(arg[0]), number, true, synge_clear, pos, evalstack);
+		/* is the result a nan? */
+		if(mpfr_nan_p(state->result))
+			return eval_return(state, frame, to_error_code(UNDEFINED, pos));
+	} else if(exp) {
+		/* evaluate a user function's value in its own frame */
+		return eval_call(state, frame, tp, exp, str, pos, pos);
+	} else {
+		/* unknown variable or function */
+		return eval_return(state, frame, to_error_code(UNKNOWN_TOKEN, pos));
+	}
 
-					if(!tmp) {
-						mpfr_clear(*result);
-						free(result);
-					}
-					free(tmpstr);
-				}
-				break;
-			case preop:
-				{
-					if(stack_size(evalstack) < 1) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(OPERATOR_WRONG_ARGC, pos);
-					}
+	return eval_return(state, frame, to_error_code(SUCCESS, -1));
+} /* eval_word() */
 
-					if(top_stack(evalstack)->tp != number) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_LEFT_OPERAND, pos);
-					}
+/* bits a small integer can be shifted by without losing its sign */
+#define INTEGER_BITS ((int) (sizeof(long) * CHAR_BIT - 1))
+
+/* the operators on small integers, which give up (returning false) whenever the result wouldn't fit, or the full
+ * precision path has something more to say about it (dividing by zero, or giving a negative zero) */
+static bool integer_unary(int op, long a, long *result) {
+	switch(op) {
+		case op_add:
+			*result = a;
+			return true;
+		case op_subtract:
+			if(a == 0 || a == LONG_MIN)
+				return false;
+
+			*result = -a;
+			return true;
+		case op_bnot:
+			/* !a => a == 0 */
+			*result = a == 0;
+			return true;
+		case op_binv:
+			/* ~a => -(a+1) */
+			if(a == LONG_MAX || a == -1)
+				return false;
+
+			*result = -(a + 1);
+			return true;
+	}
 
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
+	return false;
+} /* integer_unary() */
+
+static bool integer_binary(int op, long a, long b, long *result) {
+	switch(op) {
+		case op_add:
+			if((b > 0 && a > LONG_MAX - b) || (b < 0 && a < LONG_MIN - b))
+				return false;
+
+			*result = a + b;
+			return true;
+		case op_subtract:
+			if((b < 0 && a > LONG_MAX + b) || (b > 0 && a < LONG_MIN + b))
+				return false;
+
+			*result = a - b;
+			return true;
+		case op_multiply:
+			if(a == 0 || b == 0) {
+				/* 0 * -b is a negative zero */
+				if(a < 0 || b < 0)
+					return false;
+
+				*result = 0;
+				return true;
+			}
 
-					mpfr_set(arg[0], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
-					free_stack_cont(pop_stack(evalstack));
+			if(a > 0 ? (b > 0 ? a > LONG_MAX / b : b < LONG_MIN / a) : (b > 0 ? a < LONG_MIN / b : b < LONG_MAX / a))
+				return false;
 
-					switch(get_op(stackp.val).tp) {
-						case op_bnot:
-							{
-								/* !a => a == 0 */
-								mpfr_set_si(*result, iszero(arg[0]), SYNGE_ROUND);
-							}
-							break;
-						case op_binv:
-							{
-								mpfr_round(*result, arg[0]);
-
-								/* ~a => -(a+1) */
-								mpfr_add_si(*result, *result, 1, SYNGE_ROUND);
-								mpfr_neg(*result, *result, SYNGE_ROUND);
-							}
-							break;
-						default:
-							break;
-					}
+			*result = a * b;
+			return true;
+		case op_int_divide:
+		case op_modulo:
+			{
+				if(b == 0 || (a == LONG_MIN && b == -1))
+					return false;
 
-					/* push result of evaluation onto the stack */
-					push_valstack(result, number, true, synge_clear, pos, evalstack);
-				}
-				break;
-			case delop:
-				{
-					if(stack_size(evalstack) < 1) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(OPERATOR_WRONG_ARGC, pos);
-					}
+				/* ldiv() truncates, like mpfr_trunc() and mpfr_fmod() */
+				ldiv_t div = ldiv(a, b);
 
-					/* get word */
-					if(top_stack(evalstack)->tp != setword) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(INVALID_DELETE, pos);
-					}
+				if(op == op_int_divide) {
+					if(div.quot == 0 && (a < 0) != (b < 0))
+						return false;
 
-					char *tmpstr = str_dup(top_stack(evalstack)->val);
-					free_stack_cont(pop_stack(evalstack));
+					*result = div.quot;
+				} else {
+					if(div.rem == 0 && a < 0)
+						return false;
 
-					/* get value of word */
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
+					*result = div.rem;
+				}
+			}
+			return true;
+		case op_gt:
+			*result = a > b;
+			return true;
+		case op_gteq:
+			*result = a >= b;
+			return true;
+		case op_lt:
+			*result = a < b;
+			return true;
+		case op_lteq:
+			*result = a <= b;
+			return true;
+		case op_neq:
+			*result = a != b;
+			return true;
+		case op_eq:
+			*result = a == b;
+			return true;
+		case op_band:
+			*result = a & b;
+			return true;
+		case op_bor:
+			*result = a | b;
+			return true;
+		case op_bxor:
+			*result = a ^ b;
+			return true;
+		case op_bshiftl:
+		case op_bshiftr:
+			{
+				/* x << -y === x >> y */
+				if(b < 0) {
+					if(b < -INTEGER_BITS + 1)
+						return false;
 
-					ecode[0] = eval_word(tmpstr, pos, result); /* ignore eval error for now (since word must be deleted) */
+					op = op == op_bshiftl ? op_bshiftr : op_bshiftl;
+					b = -b;
+				}
 
-					/* delete word */
-					ecode[1] = del_word(tmpstr, pos);
+				if(b >= INTEGER_BITS)
+					return false;
 
-					/* delete error check */
-					if(!synge_is_success_code(ecode[1].code)) {
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free(tmpstr);
-						free_stackm(&evalstack, rpn);
-						return ecode[1];
-					}
+				long scale = 1L << b;
 
-					/* eval error check */
-					if(!synge_is_success_code(ecode[0].code)) {
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free(tmpstr);
-						free_stackm(&evalstack, rpn);
-						return to_error_code(ERROR_DELETE, pos);
-					}
+				if(op == op_bshiftl) {
+					if(a > LONG_MAX / scale || a < LONG_MIN / scale)
+						return false;
 
-					push_valstack(result, number, true, synge_clear, pos, evalstack);
-					free(tmpstr);
-				}
-				break;
-			case userword:
-				{
-					char *tmpstr = stackp.val;
-
-					/* initialise result */
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
-
-					/* get word */
-					ecode[0] = eval_word(tmpstr, pos, result);
-					if(!synge_is_success_code(ecode[0].code)) {
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free_stackm(&evalstack, rpn);
-						return ecode[0];
-					}
+					*result = a * scale;
+				} else {
+					*result = ldiv(a, scale).quot;
 
-					/* push result of evaluation onto the stack */
-					push_valstack(result, number, true, synge_clear, pos, evalstack);
-				}
-				break;
-			case func:
-				/* check if there is enough numbers for function arguments */
-				if(stack_size(evalstack) < 1) {
-					free_stackm(&evalstack, rpn);
-					mpfr_clears(arg[0], arg[1], arg[2], NULL);
-					return to_error_code(FUNCTION_WRONG_ARGC, pos);
+					/* (a negative number shifted to nothing is a negative zero) */
+					if(*result == 0 && a < 0)
+						return false;
 				}
+			}
+			return true;
+	}
 
-				/* get the first (and, for now, only) argument */
-				mpfr_set(arg[0], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
-				free_stack_cont(pop_stack(evalstack));
+	return false;
+} /* integer_binary() */
+
+/* bits an exact integer can grow to by being shifted, before giving up and using a synge_t */
+#define BIGINT_MAX_BITS (1 << 20)
+
+static bool isshift(int op) {
+	return op == op_bshiftl || op == op_bshiftr || op == op_ca_bshiftl || op == op_ca_bshiftr;
+} /* isshift() */
+
+/* the bitwise operators on exact integers of any size, which give up (returning false) for shifts which would be too
+ * large to do exactly, or which would give a negative zero (the sign of a which has been rounded to an integer) */
+static bool bigint_binary(int op, mpz_t a, mpz_t b, bool negative, mpz_t result) {
+	switch(op) {
+		case op_band:
+		case op_ca_band:
+			mpz_and(result, a, b);
+			return true;
+		case op_bor:
+		case op_ca_bor:
+			mpz_ior(result, a, b);
+			return true;
+		case op_bxor:
+		case op_ca_bxor:
+			mpz_xor(result, a, b);
+			return true;
+		case op_bshiftl:
+		case op_bshiftr:
+		case op_ca_bshiftl:
+		case op_ca_bshiftr:
+			{
+				if(!mpz_fits_slong_p(b) || mpz_get_si(b) == LONG_MIN)
+					return false;
 
-				/* does the input need to be converted? */
-				if(get_from_ch_list(FUNCTION(stackp.val)->name, angle_infunc_list)) /* convert settings angles to radians */
-					settings_to_rad(arg[0], arg[0]);
+				long shift = mpz_get_si(b);
+				bool left = op == op_bshiftl || op == op_ca_bshiftl;
 
-				/* allocate result and evaluate it */
-				result = malloc(sizeof(synge_t));
-				mpfr_init2(*result, SYNGE_PRECISION);
+				/* x << -y === x >> y */
+				if(shift < 0) {
+					left = !left;
+					shift = -shift;
+				}
 
-				FUNCTION(stackp.val)->get(*result, arg[0], SYNGE_ROUND);
+				if(left) {
+					if(mpz_sizeinbase(a, 2) + shift > BIGINT_MAX_BITS)
+						return false;
 
-				/* does the output need to be converted? */
-				if(get_from_ch_list(FUNCTION(stackp.val)->name, angle_outfunc_list)) /* convert radians to settings angles */
-					rad_to_settings(*result, *result);
+					mpz_mul_2exp(result, a, shift);
+				} else {
+					/* truncates, like mpfr_trunc() */
+					mpz_tdiv_q_2exp(result, a, shift);
+				}
 
-				/* push result of evaluation onto the stack */
-				push_valstack(result, number, true, synge_clear, pos, evalstack);
-				break;
-			case elseop:
-				{
-					i++; /* skip past the if conditional */
-
-					if(stack_size(evalstack) < 3) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(OPERATOR_WRONG_ARGC, pos);
-					}
+				if(!mpz_sgn(result) && negative)
+					return false;
+			}
+			return true;
+	}
 
-					if((*rpn)->content[i].tp != ifop) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(MISSING_IF, pos);
-					}
+	return false;
+} /* bigint_binary() */
+
+/* whether a number can be used by bigint_binary() without allocating an unreasonably large integer */
+static bool bigint_operand(synge_t num) {
+	return mpfr_zero_p(num) || (mpfr_number_p(num) && mpfr_get_exp(num) <= BIGINT_MAX_BITS);
+} /* bigint_operand() */
+
+static bool bigint_stack_operand(struct stack_cont *s) {
+	return s->tag != tag_number || bigint_operand(s->val.num);
+} /* bigint_stack_operand() */
+
+/* whether a number is stored exactly (as an integer or a fraction) */
+static bool rational_stack_operand(struct stack_cont *s) {
+	return s->tag == tag_integer || s->tag == tag_bigint || s->tag == tag_rational;
+} /* rational_stack_operand() */
+
+/* whether a number on an evaluation stack is false. in exact mode, exact numbers are only false if they are exactly zero
+ * (anything else is compared with epsilon, so that rounding errors don't make numbers true) */
+static bool stack_is_false(struct eval_state *state, struct stack_cont *s, synge_t tmp) {
+	if(state->ctx->settings.arithmetic == exact && rational_stack_operand(s)) {
+		if(s->tag == tag_integer)
+			return s->val.integer == 0;
+
+		mpq_t exact;
+		mpq_init(exact);
+		get_ratstack(s, exact);
+
+		bool zero = mpq_sgn(exact) == 0;
+		mpq_clear(exact);
+		return zero;
+	}
 
-					/* get else value */
-					if(top_stack(evalstack)->tp != expression) {
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(UNKNOWN_ERROR, pos);
-					}
+	get_numstack(s, tmp);
+	return iszero(tmp);
+} /* stack_is_false() */
+
+/* the basic operators on exact fractions (in exact mode), which give up (returning false) for anything else, for
+ * division by zero and for powers which aren't integers or would be unreasonably large */
+static bool rational_binary(int op, mpq_t a, mpq_t b, mpq_t result) {
+	switch(op) {
+		case op_add:
+			mpq_add(result, a, b);
+			return true;
+		case op_subtract:
+			mpq_sub(result, a, b);
+			return true;
+		case op_multiply:
+			mpq_mul(result, a, b);
+			return true;
+		case op_divide:
+			if(!mpq_sgn(b))
+				return false;
+
+			mpq_div(result, a, b);
+			return true;
+		case op_index:
+			{
+				if(mpz_cmp_ui(mpq_denref(b), 1) || !mpz_fits_slong_p(mpq_numref(b)) || mpz_get_si(mpq_numref(b)) == LONG_MIN)
+					return false;
 
-					char *tmpelse = str_dup(top_stack(evalstack)->val);
-					free_stack_cont(pop_stack(evalstack));
+				long power = mpz_get_si(mpq_numref(b));
+				unsigned long n = labs(power), bits = mpz_sizeinbase(mpq_numref(a), 2) + mpz_sizeinbase(mpq_denref(a), 2);
 
-					/* get if value */
-					if(top_stack(evalstack)->tp != expression) {
-						free(tmpelse);
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(UNKNOWN_ERROR, pos);
-					}
+				/* 0^-n is infinite */
+				if((power < 0 && !mpq_sgn(a)) || (n && bits > BIGINT_MAX_BITS / n))
+					return false;
 
-					char *tmpif = str_dup(top_stack(evalstack)->val);
-					free_stack_cont(pop_stack(evalstack));
+				/* the powers of a canonical fraction's parts are still coprime */
+				mpz_pow_ui(mpq_numref(result), mpq_numref(a), n);
+				mpz_pow_ui(mpq_denref(result), mpq_denref(a), n);
 
-					/* get if condition */
-					if(top_stack(evalstack)->tp != number) {
-						free(tmpif);
-						free(tmpelse);
-						free_stackm(&evalstack, rpn);
-						mpfr_clears(arg[0], arg[1], arg[2], NULL);
-						return to_error_code(UNKNOWN_ERROR, pos);
-					}
+				if(power < 0)
+					mpq_inv(result, result);
+			}
+			return true;
+		case op_gt:
+			mpq_set_si(result, mpq_cmp(a, b) > 0, 1);
+			return true;
+		case op_gteq:
+			mpq_set_si(result, mpq_cmp(a, b) >= 0, 1);
+			return true;
+		case op_lt:
+			mpq_set_si(result, mpq_cmp(a, b) < 0, 1);
+			return true;
+		case op_lteq:
+			mpq_set_si(result, mpq_cmp(a, b) <= 0, 1);
+			return true;
+		case op_neq:
+			mpq_set_si(result, !mpq_equal(a, b), 1);
+			return true;
+		case op_eq:
+			mpq_set_si(result, mpq_equal(a, b), 1);
+			return true;
+	}
 
-					mpfr_set(arg[0], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
-					free_stack_cont(pop_stack(evalstack));
+	return false;
+} /* rational_binary() */
 
-					result = malloc(sizeof(synge_t));
-					mpfr_init2(*result, SYNGE_PRECISION);
+/* evaluate the next instruction in a frame */
+static struct synge_err eval_instruction(struct eval_state *state, struct eval_frame *frame) {
+	struct synge_ctx *ctx = state->ctx;
+	struct stack *evalstack = frame->evalstack;
 
-					struct synge_err tmpecode;
+	/* shorthand variables */
+	struct stack_cont stackp = frame->rpn->content[frame->index++];
+	int pos = stackp.position, tmp = 0;
 
-					/* set correct value */
-					if(!iszero(arg[0]))
-						/* if expression */
-						tmpecode = eval_expression(tmpif, SYNGE_IF, (*rpn)->content[i].position, result);
-					else
-						/* else expression */
-						tmpecode = eval_expression(tmpelse, SYNGE_ELSE, (*rpn)->content[i-1].position, result);
+	mpfr_ptr result = state->result;
+	mpfr_ptr arg[3] = {state->arg[0], state->arg[1], state->arg[2]};
+	struct synge_err ecode;
 
-					free(tmpif);
-					free(tmpelse);
+	/* debugging */
+	switch(stackp.tag) {
+		case tag_number:
+			debug("%" SYNGE_FORMAT "\n", stackp.val.num);
+			break;
+		case tag_integer:
+			debug("%ld\n", stackp.val.integer);
+			break;
+		case tag_bigint:
+			debug("%Zd\n", stackp.val.bigint);
+			break;
+		case tag_rational:
+			debug("%Qd\n", stackp.val.rational);
+			break;
+		case tag_func:
+			debug("%s\n", stackp.val.func->name);
+			break;
+		case tag_op:
+			debug("%s\n", get_op_str(stackp.val.op));
+			break;
+		default:
+			debug("%s\n", stackp.val.str);
+			break;
+	}
 
-					if(!synge_is_success_code(tmpecode.code)) {
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free_stackm(&evalstack, rpn);
-						return tmpecode;
-					}
+	print_stack(evalstack);
 
-					push_valstack(result, number, true, synge_clear, pos, evalstack);
-				}
-				break;
-			case ifop:
-				/* ifop should never be found -- elseop always comes first in rpn stack */
-				free_stackm(&evalstack, rpn);
-				mpfr_clears(arg[0], arg[1], arg[2], NULL);
-				return to_error_code(MISSING_ELSE, pos);
-				break;
-			case signop:
-				/* check if there is enough numbers for operator "arguments" */
-				if(stack_size(evalstack) < 1) {
-					free_stackm(&evalstack, rpn);
-					mpfr_clears(arg[0], arg[1], arg[2], NULL);
+	switch(stackp.tp) {
+		case number:
+		case constant:
+			/* just push it onto the final stack */
+			if(stackp.tag == tag_integer)
+				push_integer(state, stackp.val.integer, pos, evalstack);
+			else if(stackp.tag == tag_bigint)
+				push_bigint(state, stackp.val.bigint, pos, evalstack);
+			else if(stackp.tag == tag_rational)
+				push_rational(state, stackp.val.rational, pos, evalstack);
+			else
+				push_number(state, stackp.val.num, pos, evalstack);
+			break;
+		case expression:
+		case setword:
+			/* just push it onto the final stack (the rpn stack outlives the final stack) */
+			push_strstack(stackp.val.str, stackp.tp, false, pos, evalstack);
+			break;
+		case setop:
+			{
+				if(stack_size(evalstack) < 2)
 					return to_error_code(OPERATOR_WRONG_ARGC, pos);
-				}
 
-				/* only numbers can be signed */
-				if(top_stack(evalstack)->tp != number) {
-					free_stackm(&evalstack, rpn);
-					mpfr_clears(arg[0], arg[1], arg[2], NULL);
+				char *tmpexp = NULL;
+
+				/* get new value for word */
+				if(top_stack(evalstack)->tp == number) {
+					/* variable value */
+					get_numstack(top_stack(evalstack), arg[0]);
+				} else if(top_stack(evalstack)->tp == expression) {
+					/* function expression value */
+					tmpexp = top_stack(evalstack)->val.str;
+				} else {
 					return to_error_code(INVALID_LEFT_OPERAND, pos);
 				}
 
-				/* get argument */
-				mpfr_set(arg[0], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
 				free_stack_cont(pop_stack(evalstack));
 
-				result = malloc(sizeof(synge_t));
-				mpfr_init2(*result, SYNGE_PRECISION);
+				/* get word */
+				if(top_stack(evalstack)->tp != setword)
+					return to_error_code(INVALID_LEFT_OPERAND, pos);
 
-				/* find correct evaluation and do it */
-				switch(get_op(stackp.val).tp) {
-					case op_add:
-						/* just copy value */
-						mpfr_set(*result, arg[0], SYNGE_ROUND);
+				char *tmpstr = top_stack(evalstack)->val.str;
+				free_stack_cont(pop_stack(evalstack));
+
+				/* set variable or function */
+				switch(stackp.val.op) {
+					case op_var_set:
+						ecode = set_variable(state, tmpstr, arg[0]);
 						break;
-					case op_subtract:
-						/* negate value */
-						mpfr_neg(*result, arg[0], SYNGE_ROUND);
+					case op_func_set:
+						ecode = set_function(state, tmpstr, tmpexp);
 						break;
 					default:
-						/* catch-all -- unknown token */
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free_stackm(&evalstack, rpn);
-						return to_error_code(UNKNOWN_TOKEN, pos);
+						ecode = to_error_code(UNKNOWN_ERROR, pos);
 						break;
 				}
 
-				/* push result onto stack */
-				push_valstack(result, number, true, synge_clear, pos, evalstack);
-				break;
-			case bitop:
-			case compop:
-			case addop:
-			case multop:
-			case expop:
-				/* check if there is enough numbers for operator "arguments" */
-				if(stack_size(evalstack) < 2) {
-					free_stackm(&evalstack, rpn);
-					mpfr_clears(arg[0], arg[1], arg[2], NULL);
+				/* check if an error occured in the definitions */
+				if(!synge_is_success_code(ecode.code))
+					return to_error_code(ecode.code, pos);
+
+				/* evaulate and push the value of set word */
+				return eval_word(state, frame, setop, tmpstr, pos);
+			}
+			break;
+		case modop:
+			{
+				if(stack_size(evalstack) < 2)
 					return to_error_code(OPERATOR_WRONG_ARGC, pos);
-				}
 
-				/* get second argument */
-				mpfr_set(arg[1], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
+				if(top_stack(evalstack)->tp != number)
+					return to_error_code(INVALID_RIGHT_OPERAND, pos);
+
+				/* get value to modify variable by */
+				get_numstack(top_stack(evalstack), arg[1]);
 				free_stack_cont(pop_stack(evalstack));
 
-				/* get first argument */
-				mpfr_set(arg[0], SYNGE_T(top_stack(evalstack)->val), SYNGE_ROUND);
+				/* get variable to modify */
+				if(top_stack(evalstack)->tp != setword)
+					return to_error_code(INVALID_LEFT_OPERAND, pos);
+
+				/* get variable name */
+				char *tmpstr = top_stack(evalstack)->val.str;
 				free_stack_cont(pop_stack(evalstack));
 
-				result = malloc(sizeof(synge_t));
-				mpfr_init2(*result, SYNGE_PRECISION);
+				/* check if it really is a variable */
+				if(!get_variable(ctx, tmpstr))
+					return to_error_code(INVALID_LEFT_OPERAND, pos);
+
+				/* get current value of variable */
+				mpfr_set(arg[0], *get_variable(ctx, tmpstr), SYNGE_ROUND);
 
-				/* find correct evaluation and do it */
-				switch(get_op(stackp.val).tp) {
-					case op_add:
-						mpfr_add(*result, arg[0], arg[1], SYNGE_ROUND);
+				/* evaluate changed variable */
+				switch(stackp.val.op) {
+					case op_ca_add:
+						mpfr_add(result, arg[0], arg[1], SYNGE_ROUND);
 						break;
-					case op_subtract:
-						mpfr_sub(*result, arg[0], arg[1], SYNGE_ROUND);
+					case op_ca_subtract:
+						mpfr_sub(result, arg[0], arg[1], SYNGE_ROUND);
 						break;
-					case op_multiply:
-						mpfr_mul(*result, arg[0], arg[1], SYNGE_ROUND);
+					case op_ca_multiply:
+						mpfr_mul(result, arg[0], arg[1], SYNGE_ROUND);
 						break;
-					case op_int_divide:
+					case op_ca_int_divide:
 						/* division, but the result ignores the decimals */
 						tmp = 1;
-					case op_divide:
+
+						/* fall-through */
+					case op_ca_divide:
 						if(iszero(arg[1])) {
 							/* the 11th commandment -- thoust shalt not divide by zero */
-							mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-							free(result);
-							free_stackm(&evalstack, rpn);
 							return to_error_code(DIVIDE_BY_ZERO, pos);
 						}
 
-						mpfr_div(*result, arg[0], arg[1], SYNGE_ROUND);
+						mpfr_div(result, arg[0], arg[1], SYNGE_ROUND);
 
+						/* integer division? */
 						if(tmp)
-							mpfr_trunc(*result, *result);
+							mpfr_trunc(result, result);
 						break;
-					case op_modulo:
+					case op_ca_modulo:
 						if(iszero(arg[1])) {
 							/* the 11.5th commandment -- thoust shalt not modulo by zero */
-							mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-							free(result);
-							free_stackm(&evalstack, rpn);
 							return to_error_code(MODULO_BY_ZERO, pos);
 						}
 
-						mpfr_fmod(*result, arg[0], arg[1], SYNGE_ROUND);
+						mpfr_fmod(result, arg[0], arg[1], SYNGE_ROUND);
 						break;
-					case op_index:
-						mpfr_pow(*result, arg[0], arg[1], SYNGE_ROUND);
+					case op_ca_index:
+						mpfr_pow(result, arg[0], arg[1], SYNGE_ROUND);
 						break;
-					case op_gt:
+					case op_ca_band:
+					case op_ca_bor:
+					case op_ca_bxor:
+					case op_ca_bshiftl:
+					case op_ca_bshiftr:
 						{
-							int cmp = mpfr_cmp(arg[0], arg[1]);
+							bool done = false;
 
-							/* equality => abs(arg[0] - arg[1]) < epsilon */
-							synge_t eq;
-							mpfr_init2(eq, SYNGE_PRECISION);
-							mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+							/* bitwise operators are done on exact integers */
+							if(!isshift(stackp.val.op) || (bigint_operand(arg[0]) && bigint_operand(arg[1]))) {
+								mpfr_rnd_t round = isshift(stackp.val.op) ? MPFR_RNDZ : SYNGE_ROUND;
 
-							mpfr_set_si(*result, cmp > 0 && !iszero(eq), SYNGE_ROUND);
-							mpfr_clear(eq);
-						}
-						break;
-					case op_gteq:
-						{
-							int cmp = mpfr_cmp(arg[0], arg[1]);
+								mpz_t final, op1, op2;
+								mpz_inits(final, op1, op2, NULL);
 
-							/* equality => abs(arg[0] - arg[1]) < epsilon */
-							synge_t eq;
-							mpfr_init2(eq, SYNGE_PRECISION);
-							mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+								mpfr_get_z(op1, arg[0], round);
+								mpfr_get_z(op2, arg[1], round);
 
-							mpfr_set_si(*result, cmp > 0 || iszero(eq), SYNGE_ROUND);
-							mpfr_clear(eq);
-						}
-						break;
-					case op_lt:
-						{
-							int cmp = mpfr_cmp(arg[0], arg[1]);
+								done = bigint_binary(stackp.val.op, op1, op2, mpfr_signbit(arg[0]), final);
+								if(done)
+									mpfr_set_z(result, final, SYNGE_ROUND);
 
-							/* equality => abs(arg[0] - arg[1]) < epsilon */
-							synge_t eq;
-							mpfr_init2(eq, SYNGE_PRECISION);
-							mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+								mpz_clears(final, op1, op2, NULL);
+							}
 
-							mpfr_set_si(*result, cmp < 0 && !iszero(eq), SYNGE_ROUND);
-							mpfr_clear(eq);
-						}
-						break;
-					case op_lteq:
-						{
-							int cmp = mpfr_cmp(arg[0], arg[1]);
+							if(done)
+								break;
 
-							/* equality => abs(arg[0] - arg[1]) < epsilon */
-							synge_t eq;
-							mpfr_init2(eq, SYNGE_PRECISION);
-							mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+							/* shifts too large to be done exactly */
+							mpfr_trunc(arg[1], arg[1]);
+							mpfr_trunc(arg[0], arg[0]);
 
-							mpfr_set_si(*result, cmp < 0 || iszero(eq), SYNGE_ROUND);
-							mpfr_clear(eq);
-						}
-						break;
-					case op_neq:
-						{
-							/* equality => abs(arg[0] - arg[1]) < epsilon */
-							synge_t eq;
-							mpfr_init2(eq, SYNGE_PRECISION);
-							mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+							/* x << y === x * 2^y, x >> y === x / 2^y */
+							mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
+							if(stackp.val.op == op_ca_bshiftl)
+								mpfr_mul(result, arg[0], arg[1], SYNGE_ROUND);
+							else
+								mpfr_div(result, arg[0], arg[1], SYNGE_ROUND);
 
-							mpfr_set_si(*result, !iszero(eq), SYNGE_ROUND);
-							mpfr_clear(eq);
+							/* again, integer operation */
+							mpfr_trunc(result, result);
 						}
 						break;
-					case op_eq:
-						{
-							/* equality => abs(arg[0] - arg[1]) < epsilon */
-							synge_t eq;
-							mpfr_init2(eq, SYNGE_PRECISION);
-							mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
-
-							mpfr_set_si(*result, iszero(eq), SYNGE_ROUND);
-							mpfr_clear(eq);
-						}
+					default:
+						/* catch-all -- unknown token */
+						return to_error_code(UNKNOWN_TOKEN, pos);
 						break;
-					case op_band:
-						{
-							/* initialise gmp integer types */
-							mpz_t final, op1, op2;
-							mpz_init2(final, SYNGE_PRECISION);
-							mpz_init2(op1, SYNGE_PRECISION);
-							mpz_init2(op2, SYNGE_PRECISION);
-
-							/* copy over operators to gmp integers */
-							mpfr_get_z(op1, arg[0], SYNGE_ROUND);
-							mpfr_get_z(op2, arg[1], SYNGE_ROUND);
-
-							/* do binary and, and set result */
-							mpz_and(final, op1, op2);
-							mpfr_set_z(*result, final, SYNGE_ROUND);
-
-							/* clean up */
-							mpz_clears(final, op1, op2, NULL);
-						}
+				}
+
+				/* set variable to new value */
+				set_variable(state, tmpstr, result);
+
+				/* push new value of variable */
+				push_number(state, result, pos, evalstack);
+			}
+			break;
+		case premod:
+			tmp = 1;
+			/* pass-through */
+		case postmod:
+			{
+				if(stack_size(evalstack) < 1)
+					return to_error_code(OPERATOR_WRONG_ARGC, pos);
+
+				/* get variable to modify */
+				if(top_stack(evalstack)->tp != setword)
+					return to_error_code(INVALID_LEFT_OPERAND, pos);
+
+				char *tmpstr = top_stack(evalstack)->val.str;
+				free_stack_cont(pop_stack(evalstack));
+
+				/* check if it really is a variable */
+				if(!get_variable(ctx, tmpstr))
+					return to_error_code(INVALID_LEFT_OPERAND, pos);
+
+				/* get current value of variable */
+				mpfr_set(arg[0], *get_variable(ctx, tmpstr), SYNGE_ROUND);
+
+				/* evaluate changed variable */
+				switch(stackp.val.op) {
+					case op_ca_increment:
+						mpfr_add_si(result, arg[0], 1, SYNGE_ROUND);
 						break;
-					case op_bor:
-						{
-							/* initialise gmp integer types */
-							mpz_t final, op1, op2;
-							mpz_init2(final, SYNGE_PRECISION);
-							mpz_init2(op1, SYNGE_PRECISION);
-							mpz_init2(op2, SYNGE_PRECISION);
-
-							/* copy over operators to gmp integers */
-							mpfr_get_z(op1, arg[0], SYNGE_ROUND);
-							mpfr_get_z(op2, arg[1], SYNGE_ROUND);
-
-							/* do binary or, and set result */
-							mpz_ior(final, op1, op2);
-							mpfr_set_z(*result, final, SYNGE_ROUND);
-
-							/* clean up */
-							mpz_clears(final, op1, op2, NULL);
-						}
+					case op_ca_decrement:
+						mpfr_sub_si(result, arg[0], 1, SYNGE_ROUND);
 						break;
-					case op_bxor:
-						{
-							/* initialise gmp integer types */
-							mpz_t final, op1, op2;
-							mpz_init2(final, SYNGE_PRECISION);
-							mpz_init2(op1, SYNGE_PRECISION);
-							mpz_init2(op2, SYNGE_PRECISION);
-
-							/* copy over operators to gmp integers */
-							mpfr_get_z(op1, arg[0], SYNGE_ROUND);
-							mpfr_get_z(op2, arg[1], SYNGE_ROUND);
-
-							/* do binary xor, and set result */
-							mpz_xor(final, op1, op2);
-							mpfr_set_z(*result, final, SYNGE_ROUND);
-
-							/* clean up */
-							mpz_clears(final, op1, op2, NULL);
-						}
+					default:
+						/* catch-all -- unknown token */
+						return to_error_code(UNKNOWN_TOKEN, pos);
 						break;
-					case op_bshiftl:
-						{
-							/* bitshifting is an integer operation */
-							mpfr_trunc(arg[1], arg[1]);
-							mpfr_trunc(arg[0], arg[0]);
+				}
 
-							/* x << y === x * 2^y */
-							mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
-							mpfr_mul(*result, arg[0], arg[1], SYNGE_ROUND);
+				/* set variable to new value */
+				set_variable(state, tmpstr, result);
 
-							/* again, integer operation */
-							mpfr_trunc(*result, *result);
-						}
-						break;
-					case op_bshiftr:
-						{
-							/* bitshifting is an integer operation */
-							mpfr_trunc(arg[1], arg[1]);
-							mpfr_trunc(arg[0], arg[0]);
+				/* push value of variable (depending on pre/post) */
+				push_number(state, tmp ? result : arg[0], pos, evalstack);
+			}
+			break;
+		case preop:
+			{
+				if(stack_size(evalstack) < 1)
+					return to_error_code(OPERATOR_WRONG_ARGC, pos);
 
-							/* x >> y === x / 2^y */
-							mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
-							mpfr_div(*result, arg[0], arg[1], SYNGE_ROUND);
+				if(top_stack(evalstack)->tp != number)
+					return to_error_code(INVALID_LEFT_OPERAND, pos);
 
-							/* again, integer operation */
-							mpfr_trunc(*result, *result);
+				/* small integers don't need full precision */
+				long integer;
+				if(top_stack(evalstack)->tag == tag_integer && integer_unary(stackp.val.op, top_stack(evalstack)->val.integer, &integer)) {
+					free_stack_cont(pop_stack(evalstack));
+					push_integer(state, integer, pos, evalstack);
+					break;
+				}
+
+				/* !a => a == 0 (exactly, for exact numbers in exact mode) */
+				if(stackp.val.op == op_bnot) {
+					bool zero = stack_is_false(state, top_stack(evalstack), arg[0]);
+
+					free_stack_cont(pop_stack(evalstack));
+					push_integer(state, zero, pos, evalstack);
+					break;
+				}
+
+				get_numstack(top_stack(evalstack), arg[0]);
+				free_stack_cont(pop_stack(evalstack));
+
+				switch(stackp.val.op) {
+					case op_binv:
+						{
+							mpfr_round(result, arg[0]);
+
+							/* ~a => -(a+1) */
+							mpfr_add_si(result, result, 1, SYNGE_ROUND);
+							mpfr_neg(result, result, SYNGE_ROUND);
 						}
 						break;
 					default:
-						/* catch-all -- unknown token */
-						mpfr_clears(*result, arg[0], arg[1], arg[2], NULL);
-						free(result);
-						free_stackm(&evalstack, rpn);
-						return to_error_code(UNKNOWN_TOKEN, pos);
 						break;
 				}
 
-				/* push result onto stack */
-				push_valstack(result, number, true, synge_clear, pos, evalstack);
-				break;
-			default:
-				/* catch-all -- unknown token */
-				free_stackm(&evalstack, rpn);
-				mpfr_clears(arg[0], arg[1], arg[2], NULL);
-				return to_error_code(UNKNOWN_TOKEN, pos);
+				/* push result of evaluation onto the stack */
+				push_number(state, result, pos, evalstack);
+			}
+			break;
+		case delop:
+			{
+				if(stack_size(evalstack) < 1)
+					return to_error_code(OPERATOR_WRONG_ARGC, pos);
+
+				/* get word */
+				if(top_stack(evalstack)->tp != setword)
+					return to_error_code(INVALID_DELETE, pos);
+
+				char *tmpstr = top_stack(evalstack)->val.str;
+				free_stack_cont(pop_stack(evalstack));
+
+				/* evaluate word (it is deleted once it has been evaluated) */
+				return eval_word(state, frame, delop, tmpstr, pos);
+			}
+			break;
+		case userword:
+			{
+				/* get word */
+				return eval_word(state, frame, userword, stackp.val.str, pos);
+			}
+			break;
+		case func:
+			{
+				struct synge_func *function = stackp.val.func;
+				int i, count = stackp.count;
+
+				/* check if there is the right number of numbers for function arguments */
+				if((function->args != variadic && count != function->args) || count < 1 || stack_size(evalstack) < count)
+					return to_error_code(FUNCTION_WRONG_ARGC, pos);
+
+				/* the arguments go into the registers, unless there are too many of them */
+				mpfr_ptr *args = count > 3 ? scratch_args(ctx, count) : arg;
+
+				/* get the arguments (the last one is on top) */
+				for(i = count - 1; i >= 0; i--) {
+					get_numstack(top_stack(evalstack), args[i]);
+					free_stack_cont(pop_stack(evalstack));
+				}
+
+				/* does the input need to be converted? */
+				if(function->flags & func_angle_in) /* convert settings angles to radians */
+					settings_to_rad(state, args[0], args[0]);
+
+				/* variadic functions are given an array of arguments, and functions which need random numbers use the
+				 * context's random state */
+				if(function->args == variadic)
+					function->get(result, args, (unsigned long) count, SYNGE_ROUND);
+				else if(count == 3)
+					function->get(result, args[0], args[1], args[2], SYNGE_ROUND);
+				else if(count == 2)
+					function->get(result, args[0], args[1], SYNGE_ROUND);
+				else if(function->flags & func_random)
+					function->get(result, args[0], SYNGE_ROUND, &ctx->random);
+				else
+					function->get(result, args[0], SYNGE_ROUND);
+
+				/* does the output need to be converted? */
+				if(function->flags & func_angle_out) /* convert radians to settings angles */
+					rad_to_settings(state, result, result);
+
+				/* push result of evaluation onto the stack */
+				push_number(state, result, pos, evalstack);
+			}
+			break;
+		case elseop:
+			{
+				if(stack_size(evalstack) < 3)
+					return to_error_code(OPERATOR_WRONG_ARGC, pos);
+
+				if(frame->index >= stack_size(frame->rpn) || frame->rpn->content[frame->index].tp != ifop)
+					return to_error_code(MISSING_IF, pos);
+
+				/* skip past the if conditional */
+				int ifpos = frame->rpn->content[frame->index++].position;
+
+				/* get else value */
+				if(top_stack(evalstack)->tp != expression)
+					return to_error_code(UNKNOWN_ERROR, pos);
+
+				char *tmpelse = top_stack(evalstack)->val.str;
+				free_stack_cont(pop_stack(evalstack));
+
+				/* get if value */
+				if(top_stack(evalstack)->tp != expression)
+					return to_error_code(UNKNOWN_ERROR, pos);
+
+				char *tmpif = top_stack(evalstack)->val.str;
+				free_stack_cont(pop_stack(evalstack));
+
+				/* get if condition */
+				if(top_stack(evalstack)->tp != number)
+					return to_error_code(UNKNOWN_ERROR, pos);
+
+				bool is_false = stack_is_false(state, top_stack(evalstack), arg[0]);
+				free_stack_cont(pop_stack(evalstack));
+
+				/* set correct value */
+				if(!is_false)
+					/* if expression */
+					return eval_call(state, frame, elseop, tmpif, SYNGE_IF, ifpos, pos);
+				else
+					/* else expression */
+					return eval_call(state, frame, elseop, tmpelse, SYNGE_ELSE, pos, pos);
+			}
+			break;
+		case ifop:
+			/* ifop should never be found -- elseop always comes first in rpn stack */
+			return to_error_code(MISSING_ELSE, pos);
+			break;
+		case signop:
+			/* check if there is enough numbers for operator "arguments" */
+			if(stack_size(evalstack) < 1)
+				return to_error_code(OPERATOR_WRONG_ARGC, pos);
+
+			/* only numbers can be signed */
+			if(top_stack(evalstack)->tp != number)
+				return to_error_code(INVALID_LEFT_OPERAND, pos);
+
+			/* small integers don't need full precision */
+			if(top_stack(evalstack)->tag == tag_integer) {
+				long integer;
+				if(integer_unary(stackp.val.op, top_stack(evalstack)->val.integer, &integer)) {
+					free_stack_cont(pop_stack(evalstack));
+					push_integer(state, integer, pos, evalstack);
+					break;
+				}
+			}
+
+			/* nor do large integers and exact fractions (which are never zero, so have no negative zero to worry about) */
+			if((top_stack(evalstack)->tag == tag_bigint || top_stack(evalstack)->tag == tag_rational) && (stackp.val.op == op_add || stackp.val.op == op_subtract)) {
+				mpq_t final;
+				mpq_init(final);
+
+				get_ratstack(top_stack(evalstack), final);
+				if(stackp.val.op == op_subtract)
+					mpq_neg(final, final);
+
+				free_stack_cont(pop_stack(evalstack));
+				push_rational(state, final, pos, evalstack);
+				mpq_clear(final);
 				break;
-		}
+			}
+
+			/* get argument */
+			get_numstack(top_stack(evalstack), arg[0]);
+			free_stack_cont(pop_stack(evalstack));
+
+			/* find correct evaluation and do it */
+			switch(stackp.val.op) {
+				case op_add:
+					/* just copy value */
+					mpfr_set(result, arg[0], SYNGE_ROUND);
+					break;
+				case op_subtract:
+					/* negate value */
+					mpfr_neg(result, arg[0], SYNGE_ROUND);
+					break;
+				default:
+					/* catch-all -- unknown token */
+					return to_error_code(UNKNOWN_TOKEN, pos);
+					break;
+			}
+
+			/* push result onto stack */
+			push_number(state, result, pos, evalstack);
+			break;
+		case bitop:
+		case compop:
+		case addop:
+		case multop:
+		case expop:
+			/* check if there is enough numbers for operator "arguments" */
+			if(stack_size(evalstack) < 2)
+				return to_error_code(OPERATOR_WRONG_ARGC, pos);
+
+			/* operators on small integers don't need full precision */
+			if(top_stack(evalstack)->tag == tag_integer && evalstack->content[evalstack->top - 1].tag == tag_integer) {
+				long integer;
+				if(integer_binary(stackp.val.op, evalstack->content[evalstack->top - 1].val.integer, top_stack(evalstack)->val.integer, &integer)) {
+					free_stack_cont(pop_stack(evalstack));
+					free_stack_cont(pop_stack(evalstack));
+					push_integer(state, integer, pos, evalstack);
+					break;
+				}
+			}
+
+			/* in exact mode, the basic operators keep numbers as exact fractions */
+			if(ctx->settings.arithmetic == exact && rational_stack_operand(top_stack(evalstack)) && rational_stack_operand(&evalstack->content[evalstack->top - 1])) {
+				mpq_t final, op1, op2;
+				mpq_init(final);
+				mpq_init(op1);
+				mpq_init(op2);
+
+				get_ratstack(&evalstack->content[evalstack->top - 1], op1);
+				get_ratstack(top_stack(evalstack), op2);
+
+				bool done = rational_binary(stackp.val.op, op1, op2, final);
+				if(done) {
+					free_stack_cont(pop_stack(evalstack));
+					free_stack_cont(pop_stack(evalstack));
+					push_rational(state, final, pos, evalstack);
+				}
+
+				mpq_clear(final);
+				mpq_clear(op1);
+				mpq_clear(op2);
+				if(done)
+					break;
+			}
+
+			/* bitwise operators are done on exact integers, which stay that way until something else needs them */
+			if(stackp.tp == bitop && (!isshift(stackp.val.op) || (bigint_stack_operand(top_stack(evalstack)) && bigint_stack_operand(&evalstack->content[evalstack->top - 1])))) {
+				struct stack_cont *first = &evalstack->content[evalstack->top - 1];
+				mpfr_rnd_t round = isshift(stackp.val.op) ? MPFR_RNDZ : SYNGE_ROUND;
+				bool negative = first->tag == tag_number ? mpfr_signbit(first->val.num) : first->tag == tag_integer ? first->val.integer < 0 :
+					first->tag == tag_rational ? mpq_sgn(first->val.rational) < 0 : mpz_sgn(first->val.bigint) < 0;
+
+				mpz_t final, op1, op2;
+				mpz_inits(final, op1, op2, NULL);
+
+				get_bigstack(first, op1, round);
+				get_bigstack(top_stack(evalstack), op2, round);
+
+				bool done = bigint_binary(stackp.val.op, op1, op2, negative, final);
+				if(done) {
+					free_stack_cont(pop_stack(evalstack));
+					free_stack_cont(pop_stack(evalstack));
+					push_bigint(state, final, pos, evalstack);
+				}
+
+				mpz_clears(final, op1, op2, NULL);
+				if(done)
+					break;
+			}
+
+			/* get second argument */
+			get_numstack(top_stack(evalstack), arg[1]);
+			free_stack_cont(pop_stack(evalstack));
+
+			/* get first argument */
+			get_numstack(top_stack(evalstack), arg[0]);
+			free_stack_cont(pop_stack(evalstack));
+
+			/* find correct evaluation and do it */
+			switch(stackp.val.op) {
+				case op_add:
+					mpfr_add(result, arg[0], arg[1], SYNGE_ROUND);
+					break;
+				case op_subtract:
+					mpfr_sub(result, arg[0], arg[1], SYNGE_ROUND);
+					break;
+				case op_multiply:
+					mpfr_mul(result, arg[0], arg[1], SYNGE_ROUND);
+					break;
+				case op_int_divide:
+					/* division, but the result ignores the decimals */
+					tmp = 1;
+				case op_divide:
+					if(iszero(arg[1])) {
+						/* the 11th commandment -- thoust shalt not divide by zero */
+						return to_error_code(DIVIDE_BY_ZERO, pos);
+					}
+
+					mpfr_div(result, arg[0], arg[1], SYNGE_ROUND);
+
+					if(tmp)
+						mpfr_trunc(result, result);
+					break;
+				case op_modulo:
+					if(iszero(arg[1])) {
+						/* the 11.5th commandment -- thoust shalt not modulo by zero */
+						return to_error_code(MODULO_BY_ZERO, pos);
+					}
+
+					mpfr_fmod(result, arg[0], arg[1], SYNGE_ROUND);
+					break;
+				case op_index:
+					mpfr_pow(result, arg[0], arg[1], SYNGE_ROUND);
+					break;
+				case op_gt:
+					{
+						int cmp = mpfr_cmp(arg[0], arg[1]);
+
+						/* equality => abs(arg[0] - arg[1]) < epsilon */
+						synge_t eq;
+						mpfr_init2(eq, SYNGE_PRECISION);
+						mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+
+						mpfr_set_si(result, cmp > 0 && !iszero(eq), SYNGE_ROUND);
+						mpfr_clear(eq);
+					}
+					break;
+				case op_gteq:
+					{
+						int cmp = mpfr_cmp(arg[0], arg[1]);
+
+						/* equality => abs(arg[0] - arg[1]) < epsilon */
+						synge_t eq;
+						mpfr_init2(eq, SYNGE_PRECISION);
+						mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+
+						mpfr_set_si(result, cmp > 0 || iszero(eq), SYNGE_ROUND);
+						mpfr_clear(eq);
+					}
+					break;
+				case op_lt:
+					{
+						int cmp = mpfr_cmp(arg[0], arg[1]);
+
+						/* equality => abs(arg[0] - arg[1]) < epsilon */
+						synge_t eq;
+						mpfr_init2(eq, SYNGE_PRECISION);
+						mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+
+						mpfr_set_si(result, cmp < 0 && !iszero(eq), SYNGE_ROUND);
+						mpfr_clear(eq);
+					}
+					break;
+				case op_lteq:
+					{
+						int cmp = mpfr_cmp(arg[0], arg[1]);
+
+						/* equality => abs(arg[0] - arg[1]) < epsilon */
+						synge_t eq;
+						mpfr_init2(eq, SYNGE_PRECISION);
+						mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+
+						mpfr_set_si(result, cmp < 0 || iszero(eq), SYNGE_ROUND);
+						mpfr_clear(eq);
+					}
+					break;
+				case op_neq:
+					{
+						/* equality => abs(arg[0] - arg[1]) < epsilon */
+						synge_t eq;
+						mpfr_init2(eq, SYNGE_PRECISION);
+						mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+
+						mpfr_set_si(result, !iszero(eq), SYNGE_ROUND);
+						mpfr_clear(eq);
+					}
+					break;
+				case op_eq:
+					{
+						/* equality => abs(arg[0] - arg[1]) < epsilon */
+						synge_t eq;
+						mpfr_init2(eq, SYNGE_PRECISION);
+						mpfr_sub(eq, arg[0], arg[1], SYNGE_ROUND);
+
+						mpfr_set_si(result, iszero(eq), SYNGE_ROUND);
+						mpfr_clear(eq);
+					}
+					break;
+				/* (the other bitwise operators, and shifts which aren't too large, are done on exact integers above) */
+				case op_bshiftl:
+					{
+						/* bitshifting is an integer operation */
+						mpfr_trunc(arg[1], arg[1]);
+						mpfr_trunc(arg[0], arg[0]);
+
+						/* x << y === x * 2^y */
+						mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
+						mpfr_mul(result, arg[0], arg[1], SYNGE_ROUND);
+
+						/* again, integer operation */
+						mpfr_trunc(result, result);
+					}
+					break;
+				case op_bshiftr:
+					{
+						/* bitshifting is an integer operation */
+						mpfr_trunc(arg[1], arg[1]);
+						mpfr_trunc(arg[0], arg[0]);
+
+						/* x >> y === x / 2^y */
+						mpfr_ui_pow(arg[1], 2, arg[1], SYNGE_ROUND);
+						mpfr_div(result, arg[0], arg[1], SYNGE_ROUND);
+
+						/* again, integer operation */
+						mpfr_trunc(result, result);
+					}
+					break;
+				default:
+					/* catch-all -- unknown token */
+					return to_error_code(UNKNOWN_TOKEN, pos);
+					break;
+			}
+
+			/* push result onto stack */
+			push_number(state, result, pos, evalstack);
+			break;
+		default:
+			/* catch-all -- unknown token */
+			return to_error_code(UNKNOWN_TOKEN, pos);
+			break;
 	}
 
-	/* free temporary numbers */
-	mpfr_clears(arg[0], arg[1], arg[2], NULL);
+	return to_error_code(SUCCESS, -1);
+} /* eval_instruction() */
+
+/* evaluate an expression, running user functions and conditionals in heap frames rather than recursing
+ * (if discard is set, any changes the expression makes to words are reverted once it has been evaluated) */
+struct synge_err synge_eval_string(struct synge_ctx *ctx, char *string, synge_t *output, char *caller, int position, bool discard) {
+	struct eval_state state = {
+		.ctx = ctx,
+		.frames = NULL,
+		.length = 0,
+		.size = 0,
+		.journal = {
+			.entries = NULL,
+			.length = 0,
+			.size = 0,
+			.latest = ohm_init(SYNGE_HM_SIZE, NULL)
+		},
+		.ticks = 0,
+		.angles = false
+	};
+
+	/* initialise operators and the result register (and the angle conversions) */
+	mpfr_inits2(SYNGE_PRECISION, state.result, state.arg[0], state.arg[1], state.arg[2], state.to_rad, state.from_rad, NULL);
 
-	/* if there is not one item on the stack, there are too many values on the stack */
-	if(stack_size(evalstack) != 1) {
-		free_stackm(&evalstack, rpn);
-		return to_error_code(TOO_MANY_VALUES, -1);
+	struct synge_err ecode = eval_push(&state, string, caller, position);
+
+	while(state.length > 0) {
+		struct eval_frame *frame = &state.frames[state.length - 1];
+
+		/* run the top frame until it finishes, fails or calls a new frame */
+		if(synge_is_success_code(ecode.code) && frame->index < stack_size(frame->rpn)) {
+			struct synge_watch *watch = &ctx->watch;
+			int pos = frame->rpn->content[frame->index].position;
+
+			/* every so often, check whether the evaluation has been cancelled or has run out of time */
+			if(--state.ticks <= 0) {
+				state.ticks = SYNGE_CHECK_INTERVAL;
+
+				if(watch_check(ctx) != SUCCESS) {
+					ecode = to_error_code(watch->code, pos);
+					continue;
+				}
+			}
+
+			/* stop the evaluation once it has used up its budget */
+			if(watch->limit.steps > 0 && watch->used.steps >= watch->limit.steps) {
+				ecode = to_error_code(STEP_LIMIT, pos);
+				continue;
+			}
+
+			if(watch->limit.memory > 0 && watch->used.memory > watch->limit.memory) {
+				ecode = to_error_code(MEMORY_LIMIT, pos);
+				continue;
+			}
+
+			watch->used.steps++;
+			ecode = eval_instruction(&state, frame);
+			continue;
+		}
+
+		/* hand the finished frame's result to its caller */
+		ecode = eval_pop(&state, ecode);
+		if(state.length > 0)
+			ecode = eval_return(&state, &state.frames[state.length - 1], ecode);
 	}
 
-	print_stack(evalstack);
+	mpfr_set(*output, state.result, SYNGE_ROUND);
 
-	/* otherwise, the last item is the result */
-	mpfr_set(*output, SYNGE_T(evalstack->content[0].val), SYNGE_ROUND);
+	if(discard)
+		journal_rollback(&state, 0);
 
-	free_stackm(&evalstack, rpn);
-	return to_error_code(SUCCESS, -1);
-} /* synge_eval_rpnstack() */
+	/* any published snapshot of the words may now be out of date */
+	else if(state.journal.length > 0)
+		ctx->publish.version++;
+
+	/* free memory */
+	mpfr_clears(state.result, state.arg[0], state.arg[1], state.arg[2], state.to_rad, state.from_rad, NULL);
+	journal_free(&state.journal);
+	free(state.frames);
+
+	return ecode;
+} /* synge_eval_string() */
@@ -17,14 +17,21 @@
 
 /*
  * SYNPOSIS:
- *        ./synge-eval expression[s] [-m mode] [-RVh]
+ *        ./synge-eval expression[s] [-m mode] [-E error] [-r seed:stream] [-d depth] [-t ms] [-b steps:memory:calls] [-T var:from:to:count] [-ixRVh]
  *
  * DESCRIPION:
  *        Run the expression through Synge, using the given settings, and defaults otherwise.
  *
  * OPTIONS:
  *        -m <mode>, --mode <mode> 	Sets the mode to <mode> (radians || degrees || gradians)
+ *        -E <error>, --error <error>	Sets the error format to <error> (simple || position || traceback)
  *        -R, --no-random		Make functions that depend on randomness predictable (FOR TESTING PURPOSES ONLY)
+ *        -r <seed:stream>, --stream <seed:stream>	Use the given reproducible random stream
+ *        -d <depth>, --depth <depth>	Limit nested user function calls and conditionals to <depth> levels
+ *        -t <ms>, --timeout <ms>	Stop any expression which takes longer than <ms> milliseconds
+ *        -b <steps:memory:calls>, --budget <steps:memory:calls>	Limit what each expression may use (0 for no limit)
+ *        -T <var:from:to:count>, --tabulate <var:from:to:count>	Compute each expression at <count> points, with <var> going from <from> to <to>
+ *        -x, --exact			Keep decimals exact under + - * / (and powers)
  *        -S, --no-skip			Do not skip "ignorable" error messages
  *
  *        -L, --license         Print license and warranty information
@@ -43,12 +50,23 @@
 #include <time.h>
 #include <unistd.h>
 
-#define SYNGE_EVAL_HELP "./synge-eval expression[s] [-m mode] [-RVh]\n" \
+#define SYNGE_EVAL_HELP "./synge-eval expression[s] [-m mode] [-E error] [-r seed:stream] [-d depth] [-t ms] [-b steps:memory:calls] [-T var:from:to:count] [-ixRVh]\n" \
 "\n" \
 "Run the expression through Synge, using the given settings, and defaults otherwise.\n" \
 "\n" \
 "  -m <mode>, --mode <mode>     Sets the mode to <mode> (radians || degrees || gradians)\n" \
+"  -E <error>, --error <error>  Sets the error format to <error> (simple || position || traceback)\n" \
 "  -R, --no-random              Make functions that depend on randomness predictable (FOR TESTING PURPOSES ONLY)\n" \
+"  -r <seed:stream>, --stream <seed:stream>\n" \
+"                               Use the given reproducible random stream\n" \
+"  -d <depth>, --depth <depth>  Limit nested user function calls and conditionals to <depth> levels\n" \
+"  -t <ms>, --timeout <ms>      Stop any expression which takes longer than <ms> milliseconds\n" \
+"  -b <steps:memory:calls>, --budget <steps:memory:calls>\n" \
+"                               Limit what each expression may use (0 for no limit)\n" \
+"  -T <var:from:to:count>, --tabulate <var:from:to:count>\n" \
+"                               Compute each expression at <count> points, with <var> going from <from> to <to>\n" \
+"  -i, --interval               Bound each expression with interval arithmetic first, only using full precision when needed\n" \
+"  -x, --exact                  Keep decimals exact under + - * / (and powers)\n" \
 "  -S, --no-skip                Do not skip 'ignorable' error messages\n" \
 "\n" \
 "  -L, --license                Print license and warranty information\n" \
@@ -57,9 +75,19 @@
 
 #define SYNGE_EVAL_LICENSE "Synge-Eval: A scripting interface for Synge\n" SYNGE_LICENSE
 
-struct synge_settings test_settings;
+static struct synge_settings test_settings;
+static struct synge_budget test_budget = {0, 0, 0};
 
-int skip_ignorable = 1;
+/* tabulation range (the variable is NULL if expressions aren't being tabulated) */
+static struct {
+	char *variable;
+	char *from;
+	char *to;
+	int count;
+} test_table = {NULL, NULL, NULL, 0};
+
+static int skip_ignorable = 1;
+static int use_interval = 0;
 
 void bake_args(int argc, char ***argv) {
 	test_settings = synge_get_settings();
@@ -80,10 +108,84 @@ void bake_args(int argc, char ***argv) {
 				(*argv)[i-1] = NULL;
 				(*argv)[i] = NULL;
 		}
+		else if(argc > i + 1 && (!strcmp((*argv)[i], "-E") || !strcmp((*argv)[i], "-error") || !strcmp((*argv)[i], "--error"))) {
+			i++;
+
+			if(!strcasecmp((*argv)[i], "simple"))
+				test_settings.error = simple;
+			else if(!strcasecmp((*argv)[i], "position"))
+				test_settings.error = position;
+			else if(!strcasecmp((*argv)[i], "traceback"))
+				test_settings.error = traceback;
+
+			(*argv)[i-1] = NULL;
+			(*argv)[i] = NULL;
+		}
 		else if(!strcmp((*argv)[i], "-R") || !strcmp((*argv)[i], "-no-random") || !strcmp((*argv)[i], "--no-random")) {
 			synge_seed(0); /* seed random number generator, to make it predicatable for testing */
 			(*argv)[i] = NULL;
 		}
+		else if(argc > i + 1 && (!strcmp((*argv)[i], "-r") || !strcmp((*argv)[i], "-stream") || !strcmp((*argv)[i], "--stream"))) {
+			unsigned long seed = 0, stream = 0;
+			i++;
+
+			sscanf((*argv)[i], "%lu:%lu", &seed, &stream);
+			synge_seed_stream(seed, stream);
+
+			(*argv)[i-1] = NULL;
+			(*argv)[i] = NULL;
+		}
+		else if(argc > i + 1 && (!strcmp((*argv)[i], "-d") || !strcmp((*argv)[i], "-depth") || !strcmp((*argv)[i], "--depth"))) {
+			i++;
+			test_settings.depth = atoi((*argv)[i]);
+
+			(*argv)[i-1] = NULL;
+			(*argv)[i] = NULL;
+		}
+		else if(argc > i + 1 && (!strcmp((*argv)[i], "-t") || !strcmp((*argv)[i], "-timeout") || !strcmp((*argv)[i], "--timeout"))) {
+			i++;
+			test_settings.timeout = atoi((*argv)[i]);
+
+			(*argv)[i-1] = NULL;
+			(*argv)[i] = NULL;
+		}
+		else if(argc > i + 1 && (!strcmp((*argv)[i], "-b") || !strcmp((*argv)[i], "-budget") || !strcmp((*argv)[i], "--budget"))) {
+			i++;
+			sscanf((*argv)[i], "%ld:%ld:%ld", &test_budget.steps, &test_budget.memory, &test_budget.calls);
+
+			(*argv)[i-1] = NULL;
+			(*argv)[i] = NULL;
+		}
+		else if(argc > i + 1 && (!strcmp((*argv)[i], "-T") || !strcmp((*argv)[i], "-tabulate") || !strcmp((*argv)[i], "--tabulate"))) {
+			i++;
+
+			/* split into the variable, the ends of the range and the number of points */
+			char *fields[4] = {(*argv)[i], NULL, NULL, NULL};
+			int field;
+			for(field = 1; field < 4 && fields[field - 1]; field++) {
+				fields[field] = strchr(fields[field - 1], ':');
+				if(fields[field])
+					*fields[field]++ = '\0';
+			}
+
+			if(fields[3]) {
+				test_table.variable = fields[0];
+				test_table.from = fields[1];
+				test_table.to = fields[2];
+				test_table.count = atoi(fields[3]);
+			}
+
+			(*argv)[i-1] = NULL;
+			(*argv)[i] = NULL;
+		}
+		else if(!strcmp((*argv)[i], "-i") || !strcmp((*argv)[i], "-interval") || !strcmp((*argv)[i], "--interval")) {
+			use_interval = 1;
+			(*argv)[i] = NULL;
+		}
+		else if(!strcmp((*argv)[i], "-x") || !strcmp((*argv)[i], "-exact") || !strcmp((*argv)[i], "--exact")) {
+			test_settings.arithmetic = exact;
+			(*argv)[i] = NULL;
+		}
 		else if(!strcmp((*argv)[i], "-S") || !strcmp((*argv)[i], "-no-skip") || !strcmp((*argv)[i], "--no-skip")) {
 			skip_ignorable = 0;
 			(*argv)[i] = NULL;
@@ -113,6 +215,51 @@ void bake_args(int argc, char ***argv) {
 	synge_set_settings(test_settings);
 } /* bake_args() */
 
+void print_result(struct synge_err ecode, synge_t result) {
+	if(skip_ignorable && synge_is_ignore_code(ecode.code))
+		return;
+
+	if(ecode.code != SUCCESS)
+		printf("%s\n", synge_error_msg(ecode));
+	else
+		printf("%s\n", synge_number_str(result));
+} /* print_result() */
+
+/* compute an expression over the tabulation range, printing the result at each point */
+void tabulate(char *expression) {
+	synge_t from, to;
+	mpfr_inits2(SYNGE_PRECISION, from, to, NULL);
+
+	/* the ends of the range can be expressions too */
+	struct synge_err ecode = synge_compute_string(test_table.from, &from);
+	if(ecode.code == SUCCESS)
+		ecode = synge_compute_string(test_table.to, &to);
+
+	if(ecode.code != SUCCESS) {
+		printf("%s\n", synge_error_msg(ecode));
+		mpfr_clears(from, to, NULL);
+		return;
+	}
+
+	synge_t *results = malloc(test_table.count * sizeof(synge_t));
+	struct synge_err *errors = malloc(test_table.count * sizeof(struct synge_err));
+
+	int i;
+	for(i = 0; i < test_table.count; i++)
+		mpfr_init2(results[i], SYNGE_PRECISION);
+
+	synge_tabulate(expression, test_table.variable, from, to, test_table.count, results, errors, 0);
+
+	for(i = 0; i < test_table.count; i++) {
+		print_result(errors[i], results[i]);
+		mpfr_clear(results[i]);
+	}
+
+	free(results);
+	free(errors);
+	mpfr_clears(from, to, NULL);
+} /* tabulate() */
+
 int main(int argc, char **argv) {
 	if(argc < 2)
 		return 1;
@@ -132,15 +279,17 @@ int main(int argc, char **argv) {
 		if(!argv[i])
 			continue;
 
-		ecode = synge_compute_string(argv[i], &result);
-
-		if(skip_ignorable && synge_is_ignore_code(ecode.code))
+		if(test_table.variable) {
+			tabulate(argv[i]);
 			continue;
+		}
 
-		if(ecode.code != SUCCESS)
-			printf("%s\n", synge_error_msg(ecode));
+		if(use_interval)
+			ecode = synge_compute_interval(argv[i], &result);
 		else
-			synge_printf("%.*" SYNGE_FORMAT "\n", synge_get_precision(result), result);
+			ecode = synge_compute_budget(argv[i], &result, &test_budget, NULL);
+
+		print_result(ecode, result);
 	}
 
 	mpfr_clears(result, NULL);
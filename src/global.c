@@ -21,7 +21,6 @@
 #include "common.h"
 #include "stack.h"
 #include "ohmic.h"
-#include "linked.h"
 
 /* use theta symbol for angles if appropriate */
 #if defined(SYNGE_UTF8_STRINGS)
@@ -30,32 +29,65 @@
 #	define SYNGE_THETA "x"
 #endif
 
-/* global state variables */
-int synge_started = false;
-gmp_randstate_t synge_state;
-
-/* variables and functions */
-struct ohm_t *variable_list = NULL;
-struct ohm_t *expression_list = NULL;
-synge_t prev_answer;
-
-/* traceback */
-char *error_msg_container = NULL;
-struct link_t *traceback_list = NULL;
+/* context used by the global interface */
+struct synge_ctx *default_ctx = NULL;
 
 /* default settings */
-struct synge_settings active_settings = {
+struct synge_settings default_settings = {
 	.mode = degrees,
 	.error = position,
 	.strict = strict,
-	.precision = dynamic
+	.arithmetic = approximate,
+	.precision = dynamic,
+	.depth = SYNGE_MAX_DEPTH,
+	.tails = SYNGE_MAX_TAILS,
+	.timeout = 0
 };
 
-static int synge_rand(synge_t to, synge_t number, mpfr_rnd_t round) {
+#define GOLDEN_GAMMA UINT64_C(0x9e3779b97f4a7c15)
+
+/* largest factorial worked out as an exact integer (gamma is faster past here) */
+#define SYNGE_FACT_EXACT 2048
+
+/* splitmix64's finaliser */
+static uint64_t mix64(uint64_t z) {
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+} /* mix64() */
+
+/* get the key of a stream of a seed (or of a sub-stream of another stream's key) */
+uint64_t stream_key(uint64_t seed, uint64_t stream) {
+	return mix64(mix64(seed) ^ (stream + 1) * GOLDEN_GAMMA);
+} /* stream_key() */
+
+/* 0 <= to < 1 */
+static void synge_urandom(synge_t to, struct synge_rand *random) {
+	if(!random->stream) {
+		mpfr_urandomb(to, random->state);
+		return;
+	}
+
+	/* each word is the mixed counter, so any point of a stream can be computed directly */
+	uint64_t words[SYNGE_PRECISION / 64];
+
+	int i;
+	for(i = 0; i < (int) len(words); i++)
+		words[i] = mix64(random->key + ++random->counter * GOLDEN_GAMMA);
+
+	mpz_t bits;
+	mpz_init2(bits, SYNGE_PRECISION);
+	mpz_import(bits, len(words), -1, sizeof(uint64_t), 0, 0, words);
+
+	mpfr_set_z_2exp(to, bits, -SYNGE_PRECISION, SYNGE_ROUND);
+	mpz_clear(bits);
+} /* synge_urandom() */
+
+static int synge_rand(synge_t to, synge_t number, mpfr_rnd_t round, struct synge_rand *state) {
 	/* A = rand() -- 0 <= rand() < 1 */
 	synge_t random;
 	mpfr_init2(random, SYNGE_PRECISION);
-	mpfr_urandomb(random, synge_state);
+	synge_urandom(random, state);
 
 	/* rand(B) = rand() * B -- where 0 <= rand() < 1 */
 	mpfr_mul(to, random, number, round);
@@ -65,12 +97,12 @@ static int synge_rand(synge_t to, synge_t number, mpfr_rnd_t round) {
 	return 0;
 } /* synge_rand() */
 
-static int synge_int_rand(synge_t to, synge_t number, mpfr_rnd_t round) {
+static int synge_int_rand(synge_t to, synge_t number, mpfr_rnd_t round, struct synge_rand *state) {
 	/* round input */
 	mpfr_floor(number, number);
 
 	/* get random number */
-	synge_rand(to, number, round);
+	synge_rand(to, number, round, state);
 
 	/* round output */
 	mpfr_round(to, to);
@@ -78,17 +110,24 @@ static int synge_int_rand(synge_t to, synge_t number, mpfr_rnd_t round) {
 } /* synge_int_rand() */
 
 static int synge_factorial(synge_t to, synge_t num, mpfr_rnd_t round) {
-	/* round input */
+	/* fact() has always been the factorial of the integer part, with the sign of the input (so fact(-5.5) is -120),
+	 * rather than gamma(x + 1) -- which isn't defined for negative integers */
 	synge_t number;
 	mpfr_init2(number, SYNGE_PRECISION);
 	mpfr_abs(number, num, round);
 	mpfr_floor(number, number);
 
-	/* multilply original number by reverse iterator */
-	mpfr_set_si(to, 1, round);
-	while(!iszero(number)) {
-		mpfr_mul(to, to, number, round);
-		mpfr_sub_si(number, number, 1, round);
+	if(mpfr_cmp_ui(number, SYNGE_FACT_EXACT) <= 0) {
+		/* small factorials are worked out exactly (then rounded once) */
+		mpz_t exact;
+		mpz_init(exact);
+		mpz_fac_ui(exact, mpfr_get_ui(number, round));
+		mpfr_set_z(to, exact, round);
+		mpz_clear(exact);
+	} else {
+		/* x! = gamma(x + 1), which doesn't get any slower as x grows */
+		mpfr_add_si(number, number, 1, round);
+		mpfr_gamma(to, number, round);
 	}
 
 	mpfr_copysign(to, to, num, round);
@@ -97,14 +136,17 @@ static int synge_factorial(synge_t to, synge_t num, mpfr_rnd_t round) {
 } /* synge_factorial() */
 
 static int synge_sum(synge_t to, synge_t number, mpfr_rnd_t round) {
-	/* round input */
-	mpfr_floor(number, number);
+	/* round input (without changing it) */
+	synge_t next;
+	mpfr_init2(next, SYNGE_PRECISION);
+	mpfr_floor(to, number);
 
 	/* (x * (x + 1)) / 2 */
-	mpfr_set(to, number, round);
-	mpfr_add_si(number, number, 1, round);
-	mpfr_mul(to, to, number, round);
+	mpfr_add_si(next, to, 1, round);
+	mpfr_mul(to, to, next, round);
 	mpfr_div_si(to, to, 2, round);
+
+	mpfr_clears(next, NULL);
 	return 0;
 } /* synge_sum() */
 
@@ -112,50 +154,165 @@ static int synge_bool(synge_t to, synge_t check, mpfr_rnd_t round) {
 	return mpfr_set_si(to, iszero(check) ? 0 : 1, round);
 } /* synge_bool() */
 
-/* builtin function names, prototypes, descriptions and function pointers */
+static int synge_log_base(synge_t to, synge_t base, synge_t num, mpfr_rnd_t round) {
+	/* the common bases have exact versions */
+	if(!mpfr_cmp_ui(base, 2))
+		return mpfr_log2(to, num, round);
+	else if(!mpfr_cmp_ui(base, 10))
+		return mpfr_log10(to, num, round);
+
+	synge_t denom;
+	mpfr_init2(denom, SYNGE_PRECISION);
+
+	/* log_b(n) = ln(n) / ln(b) */
+	mpfr_log(denom, base, round);
+	mpfr_log(to, num, round);
+	int ret = mpfr_div(to, to, denom, round);
+
+	mpfr_clear(denom);
+	return ret;
+} /* synge_log_base() */
+
+static int synge_min(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	int ret = mpfr_set(to, args[0], round);
+
+	unsigned long i;
+	for(i = 1; i < count; i++)
+		ret = mpfr_min(to, to, args[i], round);
+
+	return ret;
+} /* synge_min() */
+
+static int synge_max(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	int ret = mpfr_set(to, args[0], round);
+
+	unsigned long i;
+	for(i = 1; i < count; i++)
+		ret = mpfr_max(to, to, args[i], round);
+
+	return ret;
+} /* synge_max() */
+
+/* the aggregates are given copies of their arguments, so they can work in place without any temporaries */
+static int synge_total(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	/* correctly rounded, with a single rounding */
+	return mpfr_sum(to, args, count, round);
+} /* synge_total() */
+
+static int synge_mean(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	mpfr_sum(to, args, count, round);
+	return mpfr_div_ui(to, to, count, round);
+} /* synge_mean() */
+
+static int synge_prod(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	int ret = mpfr_set(to, args[0], round);
+
+	unsigned long i;
+	for(i = 1; i < count; i++)
+		ret = mpfr_mul(to, to, args[i], round);
+
+	return ret;
+} /* synge_prod() */
+
+static int synge_stddev(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	synge_t mean;
+	mpfr_init2(mean, SYNGE_PRECISION);
+	synge_mean(mean, args, count, round);
+
+	/* square the deviations in place, and sum them in one go */
+	unsigned long i;
+	for(i = 0; i < count; i++) {
+		mpfr_sub(args[i], args[i], mean, round);
+		mpfr_sqr(args[i], args[i], round);
+	}
+
+	mpfr_clear(mean);
+
+	/* population standard deviation */
+	mpfr_sum(to, args, count, round);
+	mpfr_div_ui(to, to, count, round);
+	return mpfr_sqrt(to, to, round);
+} /* synge_stddev() */
+
+static int synge_dot(synge_t to, mpfr_ptr *args, unsigned long count, mpfr_rnd_t round) {
+	/* the first half of the arguments is one vector, and the second half is the other */
+	if(count % 2) {
+		mpfr_set_nan(to);
+		return 0;
+	}
+
+	count /= 2;
+
+#if MPFR_VERSION >= MPFR_VERSION_NUM(4,1,0)
+	/* correctly rounded, with a single rounding */
+	return mpfr_dot(to, args, args + count, count, round);
+#else
+	/* multiply in place, and sum the products in one go */
+	unsigned long i;
+	for(i = 0; i < count; i++)
+		mpfr_mul(args[i], args[i], args[count + i], round);
+
+	return mpfr_sum(to, args, count, round);
+#endif
+} /* synge_dot() */
+
+/* builtin function names, prototypes, descriptions, function pointers and argument counts */
 struct synge_func func_list[] = {
-	{"abs",		"abs(n)",						"Absolute value of n",								mpfr_abs},
-	{"sqrt",	"sqrt(n)",						"Square root of n",									mpfr_sqrt},
-	{"cbrt",	"cbrt(n)",						"Cubic root of n",									mpfr_cbrt},
-
-	{"round",	"round(n)",						"Round n away from 0",								mpfr_round},
-	{"ceil",	"ceil(n)",						"Round n toward positive infinity",					mpfr_ceil},
-	{"floor",	"floor(n)",						"Round n toward negative infinity",					mpfr_floor},
-
-	{"log",		"log(n)",						"Base 2 logarithm of n",							mpfr_log2},
-	{"ln",		"ln(n)",						"Natural logarithm of n",							mpfr_log},
-	{"log10",	"log10(n)",						"Base 10 logarithm of n",							mpfr_log10},
-
-	{"rand",	"rand(n)",						"Generate a random number between 0 and n",			synge_rand},
-	{"randi",	"randi(n)",						"Generate a random integer between 0 and n",		synge_int_rand},
-
-	{"fact",	"fact(n)",						"Factorial of the integer n",						synge_factorial},
-	{"sum",		"sum(n)",						"Gives sum of all integers up to n",				synge_sum},
-	{"bool",	"bool(n)",						"Returns 0 if x is falseish, 1 otherwise",			synge_bool},
-
-	{"deg2rad",	"deg2rad(" SYNGE_THETA ")",		"Convert " SYNGE_THETA " degrees to radians",		deg_to_rad},
-	{"deg2grad","deg2grad(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " degrees to gradians",		deg_to_grad},
-
-	{"rad2deg",	"rad2deg(" SYNGE_THETA ")",		"Convert " SYNGE_THETA " radians to degrees",		rad_to_deg},
-	{"rad2grad","rad2grad(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " radians to gradians",		rad_to_grad},
-
-	{"grad2deg","grad2deg(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " gradians to degrees",		grad_to_deg},
-	{"grad2rad","grad2rad(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " gradians to radians",		grad_to_rad},
-
-	{"sinh",	"sinh(" SYNGE_THETA ")",		"Hyperbolic sine of " SYNGE_THETA "",				mpfr_sinh},
-	{"cosh",	"cosh(" SYNGE_THETA ")",		"Hyperbolic cosine of " SYNGE_THETA "",				mpfr_cosh},
-	{"tanh",	"tanh(" SYNGE_THETA ")",		"Hyperbolic tangent of " SYNGE_THETA "",			mpfr_tanh},
-	{"asinh",	"asinh(" SYNGE_THETA ")",		"Inverse hyperbolic sine of " SYNGE_THETA "",		mpfr_asinh},
-	{"acosh",	"acosh(" SYNGE_THETA ")",		"Inverse hyperbolic cosine of " SYNGE_THETA "",		mpfr_acosh},
-	{"atanh",	"atanh(" SYNGE_THETA ")",		"Inverse hyperbolic tangent of " SYNGE_THETA "",	mpfr_atanh},
-
-	{"sin",		"sin(" SYNGE_THETA ")",			"Sine of " SYNGE_THETA "",							mpfr_sin},
-	{"cos",		"cos(" SYNGE_THETA ")",			"Cosine of " SYNGE_THETA "",						mpfr_cos},
-	{"tan",		"tan(" SYNGE_THETA ")",			"Tangent of " SYNGE_THETA "",						mpfr_tan},
-	{"asin",	"asin(" SYNGE_THETA ")",		"Inverse sine of " SYNGE_THETA "",					mpfr_asin},
-	{"acos",	"acos(" SYNGE_THETA ")",		"Inverse cosine of " SYNGE_THETA "",				mpfr_acos},
-	{"atan",	"atan(" SYNGE_THETA ")",		"Inverse tangent of " SYNGE_THETA "",				mpfr_atan},
-	{NULL,		NULL,			NULL,												NULL}
+	{"abs",		"abs(n)",						"Absolute value of n",								mpfr_abs,			1,			0},
+	{"sqrt",	"sqrt(n)",						"Square root of n",									mpfr_sqrt,			1,			0},
+	{"cbrt",	"cbrt(n)",						"Cubic root of n",									mpfr_cbrt,			1,			0},
+
+	{"round",	"round(n)",						"Round n away from 0",								mpfr_round,			1,			0},
+	{"ceil",	"ceil(n)",						"Round n toward positive infinity",					mpfr_ceil,			1,			0},
+	{"floor",	"floor(n)",						"Round n toward negative infinity",					mpfr_floor,			1,			0},
+
+	{"log",		"log(n)",						"Base 2 logarithm of n",							mpfr_log2,			1,			0},
+	{"ln",		"ln(n)",						"Natural logarithm of n",							mpfr_log,			1,			0},
+	{"log10",	"log10(n)",						"Base 10 logarithm of n",							mpfr_log10,			1,			0},
+	{"log",		"log(b, n)",					"Base b logarithm of n",							synge_log_base,		2,			0},
+
+	{"rand",	"rand(n)",						"Generate a random number between 0 and n",			synge_rand,			1,			func_random},
+	{"randi",	"randi(n)",						"Generate a random integer between 0 and n",		synge_int_rand,		1,			func_random},
+
+	{"fact",	"fact(n)",						"Factorial of the integer n",						synge_factorial,	1,			0},
+	{"sum",		"sum(n)",						"Sum of the integers from 1 to n",					synge_sum,			1,			0},
+	{"bool",	"bool(n)",						"Returns 0 if x is falseish, 1 otherwise",			synge_bool,			1,			0},
+
+	{"pow",		"pow(x, y)",					"x to the power of y",								mpfr_pow,			2,			0},
+	{"hypot",	"hypot(x, y)",					"Length of the hypotenuse with sides x and y",		mpfr_hypot,			2,			0},
+	{"fma",		"fma(x, y, z)",					"x * y + z, rounded only once",						mpfr_fma,			3,			0},
+	{"min",		"min(n, ...)",					"Smallest of the arguments",						synge_min,			variadic,	0},
+	{"max",		"max(n, ...)",					"Largest of the arguments",							synge_max,			variadic,	0},
+	{"total",	"total(n, ...)",				"Sum of the arguments",								synge_total,		variadic,	0},
+	{"mean",	"mean(n, ...)",					"Arithmetic mean of the arguments",					synge_mean,			variadic,	0},
+	{"prod",	"prod(n, ...)",					"Product of the arguments",							synge_prod,			variadic,	0},
+	{"stddev",	"stddev(n, ...)",				"Population standard deviation of the arguments",	synge_stddev,		variadic,	0},
+	{"dot",		"dot(a..., b...)",				"Dot product of the two halves of the arguments",	synge_dot,			variadic,	0},
+
+	{"deg2rad",	"deg2rad(" SYNGE_THETA ")",		"Convert " SYNGE_THETA " degrees to radians",		deg_to_rad,			1,			0},
+	{"deg2grad","deg2grad(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " degrees to gradians",		deg_to_grad,		1,			0},
+
+	{"rad2deg",	"rad2deg(" SYNGE_THETA ")",		"Convert " SYNGE_THETA " radians to degrees",		rad_to_deg,			1,			0},
+	{"rad2grad","rad2grad(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " radians to gradians",		rad_to_grad,		1,			0},
+
+	{"grad2deg","grad2deg(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " gradians to degrees",		grad_to_deg,		1,			0},
+	{"grad2rad","grad2rad(" SYNGE_THETA ")",	"Convert " SYNGE_THETA " gradians to radians",		grad_to_rad,		1,			0},
+
+	{"sinh",	"sinh(" SYNGE_THETA ")",		"Hyperbolic sine of " SYNGE_THETA "",				mpfr_sinh,			1,			0},
+	{"cosh",	"cosh(" SYNGE_THETA ")",		"Hyperbolic cosine of " SYNGE_THETA "",				mpfr_cosh,			1,			0},
+	{"tanh",	"tanh(" SYNGE_THETA ")",		"Hyperbolic tangent of " SYNGE_THETA "",			mpfr_tanh,			1,			0},
+	{"asinh",	"asinh(" SYNGE_THETA ")",		"Inverse hyperbolic sine of " SYNGE_THETA "",		mpfr_asinh,			1,			0},
+	{"acosh",	"acosh(" SYNGE_THETA ")",		"Inverse hyperbolic cosine of " SYNGE_THETA "",		mpfr_acosh,			1,			0},
+	{"atanh",	"atanh(" SYNGE_THETA ")",		"Inverse hyperbolic tangent of " SYNGE_THETA "",	mpfr_atanh,			1,			0},
+
+	{"sin",		"sin(" SYNGE_THETA ")",			"Sine of " SYNGE_THETA "",							mpfr_sin,			1,			func_angle_in},
+	{"cos",		"cos(" SYNGE_THETA ")",			"Cosine of " SYNGE_THETA "",						mpfr_cos,			1,			func_angle_in},
+	{"tan",		"tan(" SYNGE_THETA ")",			"Tangent of " SYNGE_THETA "",						mpfr_tan,			1,			func_angle_in},
+	{"asin",	"asin(" SYNGE_THETA ")",		"Inverse sine of " SYNGE_THETA "",					mpfr_asin,			1,			func_angle_out},
+	{"acos",	"acos(" SYNGE_THETA ")",		"Inverse cosine of " SYNGE_THETA "",				mpfr_acos,			1,			func_angle_out},
+	{"atan",	"atan(" SYNGE_THETA ")",		"Inverse tangent of " SYNGE_THETA "",				mpfr_atan,			1,			func_angle_out},
+	{"atan2",	"atan2(y, x)",					"Angle of the point (x, y) from the x axis",		mpfr_atan2,			2,			func_angle_out},
+	{NULL,		NULL,			NULL,												NULL,		0,	0}
 };
 
 /* used for when a (char *) is needed, but needn't be freed and *
@@ -171,6 +328,7 @@ struct synge_op op_list[] = {
 
 	{"(",	op_lparen},
 	{")",	op_rparen},
+	{",",	op_separator}, /* function arguments */
 
 	/* comparison operators */
 	{">",	op_gt},
@@ -224,12 +382,12 @@ struct synge_op op_list[] = {
 	{NULL,	op_none}
 };
 
-static int synge_pi(synge_t num, mpfr_rnd_t round) {
+static int synge_pi(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
 	mpfr_const_pi(num, round);
 	return 0;
 } /* synge_pi() */
 
-static int synge_phi(synge_t num, mpfr_rnd_t round) {
+static int synge_phi(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
 	/* get sqrt(5) */
 	synge_t root_five;
 	mpfr_init2(root_five, SYNGE_PRECISION);
@@ -243,7 +401,7 @@ static int synge_phi(synge_t num, mpfr_rnd_t round) {
 	return 0;
 } /* synge_phi() */
 
-static int synge_euler(synge_t num, mpfr_rnd_t round) {
+static int synge_euler(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
 	/* get one */
 	synge_t one;
 	mpfr_init2(one, SYNGE_PRECISION);
@@ -256,24 +414,24 @@ static int synge_euler(synge_t num, mpfr_rnd_t round) {
 	return 0;
 } /* synge_euler() */
 
-static int synge_life(synge_t num, mpfr_rnd_t round) {
+static int synge_life(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
 	cheeky("How many paths must a man walk down?\n");
 	mpfr_set_si(num, 42, round);
 	return 0;
 } /* synge_life() */
 
-static int synge_true(synge_t num, mpfr_rnd_t round) {
+static int synge_true(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
 	mpfr_set_si(num, 1, round);
 	return 0;
 } /* synge_true() */
 
-static int synge_false(synge_t num, mpfr_rnd_t round) {
+static int synge_false(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
 	mpfr_set_si(num, 0, round);
 	return 0;
 } /* synge_false() */
 
-static int synge_ans(synge_t num, mpfr_rnd_t round) {
-	mpfr_set(num, prev_answer, round);
+static int synge_ans(synge_t num, mpfr_rnd_t round, struct synge_ctx *ctx) {
+	mpfr_set(num, ctx->prev_answer, round);
 	return 0;
 } /* synge_ans() */
 
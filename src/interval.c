@@ -0,0 +1,738 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "synge.h"
+#include "global.h"
+#include "common.h"
+
+/* least working precision of the first attempt (each attempt after it doubles the precision) */
+#define INTERVAL_START_PRECISION 64
+
+/* bits on top of those needed for the printed digits, to give the bounds room to agree */
+#define INTERVAL_GUARD_BITS 32
+
+/* largest shift that is worked out exactly */
+#define INTERVAL_MAX_SHIFT (1 << 16)
+
+/* a range of values which contains the exact result, or nothing if the range couldn't be bounded */
+struct ival {
+	synge_t lo, hi;
+	bool known;
+};
+
+/* how a builtin function maps a range of inputs to a range of outputs */
+enum {
+	shape_increasing,
+	shape_decreasing,
+	shape_abs,
+	shape_cosh,
+	shape_sin,
+	shape_cos,
+	shape_tan,
+	shape_convert,
+	shape_bool
+};
+
+/* inputs a function is defined for */
+enum {
+	domain_any,
+	domain_nonneg, /* [0, inf) */
+	domain_positive, /* (0, inf) */
+	domain_unit, /* [-1, 1] */
+	domain_open_unit, /* (-1, 1) */
+	domain_cosh /* [1, inf) */
+};
+
+struct ival_func {
+	char *name;
+	int (*get)(); /* correctly rounded mpfr function (for monotonic shapes) */
+	int shape;
+	int domain;
+	int from, to; /* angle modes (for conversions) */
+};
+
+/* builtin functions which can be bounded -- the others (such as fact and rand) are left to the full evaluation */
+static struct ival_func ival_func_list[] = {
+	{"abs",			NULL,				shape_abs,			domain_any,			0,			0},
+	{"sqrt",		mpfr_sqrt,			shape_increasing,	domain_nonneg,		0,			0},
+	{"cbrt",		mpfr_cbrt,			shape_increasing,	domain_any,			0,			0},
+
+	{"round",		mpfr_rint_round,	shape_increasing,	domain_any,			0,			0},
+	{"ceil",		mpfr_rint_ceil,		shape_increasing,	domain_any,			0,			0},
+	{"floor",		mpfr_rint_floor,	shape_increasing,	domain_any,			0,			0},
+
+	{"log",			mpfr_log2,			shape_increasing,	domain_positive,	0,			0},
+	{"ln",			mpfr_log,			shape_increasing,	domain_positive,	0,			0},
+	{"log10",		mpfr_log10,			shape_increasing,	domain_positive,	0,			0},
+
+	{"bool",		NULL,				shape_bool,			domain_any,			0,			0},
+
+	{"deg2rad",		NULL,				shape_convert,		domain_any,			degrees,	radians},
+	{"deg2grad",	NULL,				shape_convert,		domain_any,			degrees,	gradians},
+	{"rad2deg",		NULL,				shape_convert,		domain_any,			radians,	degrees},
+	{"rad2grad",	NULL,				shape_convert,		domain_any,			radians,	gradians},
+	{"grad2deg",	NULL,				shape_convert,		domain_any,			gradians,	degrees},
+	{"grad2rad",	NULL,				shape_convert,		domain_any,			gradians,	radians},
+
+	{"sinh",		mpfr_sinh,			shape_increasing,	domain_any,			0,			0},
+	{"cosh",		mpfr_cosh,			shape_cosh,			domain_any,			0,			0},
+	{"tanh",		mpfr_tanh,			shape_increasing,	domain_any,			0,			0},
+	{"asinh",		mpfr_asinh,			shape_increasing,	domain_any,			0,			0},
+	{"acosh",		mpfr_acosh,			shape_increasing,	domain_cosh,		0,			0},
+	{"atanh",		mpfr_atanh,			shape_increasing,	domain_open_unit,	0,			0},
+
+	{"sin",			mpfr_sin,			shape_sin,			domain_any,			0,			0},
+	{"cos",			mpfr_cos,			shape_cos,			domain_any,			0,			0},
+	{"tan",			mpfr_tan,			shape_tan,			domain_any,			0,			0},
+	{"asin",		mpfr_asin,			shape_increasing,	domain_unit,		0,			0},
+	{"acos",		mpfr_acos,			shape_decreasing,	domain_unit,		0,			0},
+	{"atan",		mpfr_atan,			shape_increasing,	domain_any,			0,			0},
+	{NULL,			NULL,				0,					0,					0,			0}
+};
+
+static struct ival_func *get_ival_func(char *name) {
+	int i;
+	for(i = 0; ival_func_list[i].name; i++)
+		if(!strcmp(ival_func_list[i].name, name))
+			return &ival_func_list[i];
+
+	return NULL;
+} /* get_ival_func() */
+
+/* state while bounding a compiled expression */
+struct ival_state {
+	struct synge_vector *vector;
+	synge_t epsilon; /* anything smaller than this is zero to the engine */
+
+	/* scratch space at the working precision */
+	synge_t tmp[3];
+	struct ival aux;
+
+	synge_t big[2]; /* scratch values which hold any rounded working value exactly */
+	mpz_t z[2];
+};
+
+static void set_si(struct ival *x, long value) {
+	mpfr_set_si(x->lo, value, MPFR_RNDD);
+	mpfr_set_si(x->hi, value, MPFR_RNDU);
+} /* set_si() */
+
+static void set_z(struct ival *x, mpz_t value) {
+	mpfr_set_z(x->lo, value, MPFR_RNDD);
+	mpfr_set_z(x->hi, value, MPFR_RNDU);
+} /* set_z() */
+
+/* whether every value in the range is zero to the engine (1), none of them are (0), or only some of them are (-1) */
+static int zero_state(struct ival_state *s, struct ival *x) {
+	if(mpfr_cmpabs(x->lo, s->epsilon) < 0 && mpfr_cmpabs(x->hi, s->epsilon) < 0)
+		return 1;
+
+	if(mpfr_cmpabs(x->lo, s->epsilon) >= 0 && mpfr_cmpabs(x->hi, s->epsilon) >= 0 && mpfr_sgn(x->lo) == mpfr_sgn(x->hi))
+		return 0;
+
+	return -1;
+} /* zero_state() */
+
+/* get the integer every value in the range rounds to, or false if they don't all round to the same one */
+static bool get_integer(struct ival_state *s, mpz_t out, struct ival *x, mpfr_rnd_t round) {
+	mpfr_get_z(out, x->lo, round);
+	mpfr_get_z(s->z[1], x->hi, round);
+	return !mpz_cmp(out, s->z[1]);
+} /* get_integer() */
+
+/* bound get() over ranges where it is monotonic in both arguments (so its extremes are on the corners) */
+static void corners(struct ival_state *s, struct ival *r, struct ival *a, struct ival *b, int (*get)()) {
+	mpfr_ptr xs[2] = {a->lo, a->hi}, ys[2] = {b->lo, b->hi};
+
+	mpfr_set_inf(s->tmp[0], 1);
+	mpfr_set_inf(s->tmp[1], -1);
+
+	int i, j;
+	for(i = 0; i < 2; i++) {
+		for(j = 0; j < 2; j++) {
+			get(s->tmp[2], xs[i], ys[j], MPFR_RNDD);
+			mpfr_min(s->tmp[0], s->tmp[0], s->tmp[2], MPFR_RNDD);
+
+			get(s->tmp[2], xs[i], ys[j], MPFR_RNDU);
+			mpfr_max(s->tmp[1], s->tmp[1], s->tmp[2], MPFR_RNDU);
+		}
+	}
+
+	mpfr_set(r->lo, s->tmp[0], MPFR_RNDD);
+	mpfr_set(r->hi, s->tmp[1], MPFR_RNDU);
+} /* corners() */
+
+/* half a turn in the given angle mode */
+static void half_turn(synge_t out, int mode, mpfr_rnd_t round) {
+	switch(mode) {
+		case degrees:
+			mpfr_set_si(out, 180, round);
+			break;
+		case gradians:
+			mpfr_set_si(out, 200, round);
+			break;
+		case radians:
+		default:
+			mpfr_const_pi(out, round);
+			break;
+	}
+} /* half_turn() */
+
+/* convert a range of angles from one mode to another */
+static void convert(struct ival_state *s, struct ival *x, int from, int to) {
+	if(from == to)
+		return;
+
+	half_turn(s->tmp[0], to, MPFR_RNDD);
+	half_turn(s->tmp[1], from, MPFR_RNDU);
+	mpfr_div(s->aux.lo, s->tmp[0], s->tmp[1], MPFR_RNDD);
+
+	half_turn(s->tmp[0], to, MPFR_RNDU);
+	half_turn(s->tmp[1], from, MPFR_RNDD);
+	mpfr_div(s->aux.hi, s->tmp[0], s->tmp[1], MPFR_RNDU);
+
+	corners(s, x, x, &s->aux, mpfr_mul);
+} /* convert() */
+
+/* bound a function which never changes faster than its input (like sin and cos) by its value in the middle of the range */
+static void lipschitz(struct ival_state *s, struct ival *r, struct ival *x, int (*get)()) {
+	/* any point in the range will do as the middle, as long as the radius covers both ends */
+	mpfr_add(s->tmp[0], x->lo, x->hi, MPFR_RNDN);
+	mpfr_div_2ui(s->tmp[0], s->tmp[0], 1, MPFR_RNDN);
+
+	mpfr_sub(s->tmp[1], x->hi, s->tmp[0], MPFR_RNDU);
+	mpfr_sub(s->tmp[2], s->tmp[0], x->lo, MPFR_RNDU);
+	mpfr_max(s->tmp[1], s->tmp[1], s->tmp[2], MPFR_RNDU);
+
+	get(s->tmp[2], s->tmp[0], MPFR_RNDD);
+	mpfr_sub(r->lo, s->tmp[2], s->tmp[1], MPFR_RNDD);
+
+	get(s->tmp[2], s->tmp[0], MPFR_RNDU);
+	mpfr_add(r->hi, s->tmp[2], s->tmp[1], MPFR_RNDU);
+
+	/* both of them stay within [-1, 1] */
+	if(mpfr_cmp_si(r->lo, -1) < 0)
+		mpfr_set_si(r->lo, -1, MPFR_RNDD);
+
+	if(mpfr_cmp_si(r->hi, 1) > 0)
+		mpfr_set_si(r->hi, 1, MPFR_RNDU);
+} /* lipschitz() */
+
+static bool in_domain(struct ival *x, int domain) {
+	switch(domain) {
+		case domain_nonneg:
+			return mpfr_sgn(x->lo) >= 0;
+		case domain_positive:
+			return mpfr_sgn(x->lo) > 0;
+		case domain_unit:
+			return mpfr_cmp_si(x->lo, -1) >= 0 && mpfr_cmp_si(x->hi, 1) <= 0;
+		case domain_open_unit:
+			return mpfr_cmp_si(x->lo, -1) > 0 && mpfr_cmp_si(x->hi, 1) < 0;
+		case domain_cosh:
+			return mpfr_cmp_si(x->lo, 1) >= 0;
+		case domain_any:
+		default:
+			return true;
+	}
+} /* in_domain() */
+
+static void ival_neg(struct ival *x) {
+	mpfr_swap(x->lo, x->hi);
+	mpfr_neg(x->lo, x->lo, MPFR_RNDD);
+	mpfr_neg(x->hi, x->hi, MPFR_RNDU);
+} /* ival_neg() */
+
+/* apply a builtin function to a range */
+static void ival_func(struct ival_state *s, struct ival *x, struct ival_func *f, int flags) {
+	if(!f) {
+		x->known = false;
+		return;
+	}
+
+	/* convert the context's angles to radians */
+	if(flags & func_angle_in)
+		convert(s, x, s->vector->mode, radians);
+
+	if(!in_domain(x, f->domain)) {
+		x->known = false;
+		return;
+	}
+
+	switch(f->shape) {
+		case shape_increasing:
+			f->get(x->lo, x->lo, MPFR_RNDD);
+			f->get(x->hi, x->hi, MPFR_RNDU);
+			break;
+		case shape_decreasing:
+			f->get(s->tmp[0], x->hi, MPFR_RNDD);
+			f->get(x->hi, x->lo, MPFR_RNDU);
+			mpfr_set(x->lo, s->tmp[0], MPFR_RNDD);
+			break;
+		case shape_abs:
+			if(mpfr_sgn(x->hi) <= 0)
+				ival_neg(x);
+			else if(mpfr_sgn(x->lo) < 0) {
+				/* the range straddles zero */
+				mpfr_neg(x->lo, x->lo, MPFR_RNDU);
+				mpfr_max(x->hi, x->hi, x->lo, MPFR_RNDU);
+				mpfr_set_si(x->lo, 0, MPFR_RNDD);
+			}
+			break;
+		case shape_cosh:
+			if(mpfr_sgn(x->lo) >= 0) {
+				f->get(x->lo, x->lo, MPFR_RNDD);
+				f->get(x->hi, x->hi, MPFR_RNDU);
+			} else if(mpfr_sgn(x->hi) <= 0) {
+				f->get(s->tmp[0], x->hi, MPFR_RNDD);
+				f->get(x->hi, x->lo, MPFR_RNDU);
+				mpfr_set(x->lo, s->tmp[0], MPFR_RNDD);
+			} else {
+				/* the range straddles the minimum at zero */
+				f->get(x->lo, x->lo, MPFR_RNDU);
+				f->get(x->hi, x->hi, MPFR_RNDU);
+				mpfr_max(x->hi, x->hi, x->lo, MPFR_RNDU);
+				mpfr_set_si(x->lo, 1, MPFR_RNDD);
+			}
+			break;
+		case shape_sin:
+		case shape_cos:
+			lipschitz(s, x, x, f->get);
+			break;
+		case shape_tan:
+			/* tan is increasing between its poles, which are where cos is zero */
+			lipschitz(s, &s->aux, x, mpfr_cos);
+
+			if(mpfr_sgn(s->aux.lo) > 0 || mpfr_sgn(s->aux.hi) < 0) {
+				f->get(x->lo, x->lo, MPFR_RNDD);
+				f->get(x->hi, x->hi, MPFR_RNDU);
+			}
+			else
+				x->known = false;
+			break;
+		case shape_convert:
+			convert(s, x, f->from, f->to);
+			break;
+		case shape_bool:
+			{
+				int zero = zero_state(s, x);
+
+				if(zero < 0)
+					x->known = false;
+				else
+					set_si(x, !zero);
+			}
+			break;
+	}
+
+	/* convert radians to the context's angles */
+	if(flags & func_angle_out)
+		convert(s, x, radians, s->vector->mode);
+} /* ival_func() */
+
+static void ival_unary(struct ival_state *s, struct ival *x, int op) {
+	switch(op) {
+		case vec_neg:
+			ival_neg(x);
+			break;
+		case op_bnot:
+			{
+				/* !a => a == 0 */
+				int zero = zero_state(s, x);
+
+				if(zero < 0)
+					x->known = false;
+				else
+					set_si(x, zero);
+			}
+			break;
+		case op_binv:
+			/* ~a => -(a+1), where rounding is increasing (so the ends swap) */
+			mpfr_round(s->big[0], x->lo);
+			mpfr_round(s->big[1], x->hi);
+
+			mpfr_add_si(s->big[0], s->big[0], 1, MPFR_RNDN);
+			mpfr_add_si(s->big[1], s->big[1], 1, MPFR_RNDN);
+
+			mpfr_neg(x->lo, s->big[1], MPFR_RNDD);
+			mpfr_neg(x->hi, s->big[0], MPFR_RNDU);
+			break;
+		default:
+			break;
+	}
+} /* ival_unary() */
+
+/* shift the first integer left by the second (or right if it is negative), as the engine would */
+static bool shift(struct ival_state *s, mpz_t x, mpz_t by) {
+	if(!mpz_fits_slong_p(by) || labs(mpz_get_si(by)) > INTERVAL_MAX_SHIFT)
+		return false;
+
+	long n = mpz_get_si(by);
+
+	if(n >= 0)
+		mpz_mul_2exp(x, x, n);
+	else
+		mpz_tdiv_q_2exp(x, x, -n);
+
+	return true;
+} /* shift() */
+
+static void ival_binary(struct ival_state *s, struct ival *a, struct ival *b, int op) {
+	switch(op) {
+		case op_add:
+			mpfr_add(a->lo, a->lo, b->lo, MPFR_RNDD);
+			mpfr_add(a->hi, a->hi, b->hi, MPFR_RNDU);
+			break;
+		case op_subtract:
+			mpfr_sub(a->lo, a->lo, b->hi, MPFR_RNDD);
+			mpfr_sub(a->hi, a->hi, b->lo, MPFR_RNDU);
+			break;
+		case op_multiply:
+			corners(s, a, a, b, mpfr_mul);
+			break;
+		case op_int_divide:
+		case op_divide:
+		case op_modulo:
+			/* the engine refuses to divide by anything it thinks is zero */
+			if(zero_state(s, b)) {
+				a->known = false;
+				break;
+			}
+
+			if(op == op_divide) {
+				corners(s, a, a, b, mpfr_div);
+				break;
+			}
+
+			/* the truncated quotient */
+			corners(s, &s->aux, a, b, mpfr_div);
+			mpfr_rint_trunc(s->aux.lo, s->aux.lo, MPFR_RNDD);
+			mpfr_rint_trunc(s->aux.hi, s->aux.hi, MPFR_RNDU);
+
+			if(op == op_int_divide) {
+				mpfr_set(a->lo, s->aux.lo, MPFR_RNDD);
+				mpfr_set(a->hi, s->aux.hi, MPFR_RNDU);
+				break;
+			}
+
+			/* a % b => a - trunc(a/b)*b, but only if the quotient is the same over the whole range */
+			if(!mpfr_equal_p(s->aux.lo, s->aux.hi)) {
+				a->known = false;
+				break;
+			}
+
+			corners(s, &s->aux, &s->aux, b, mpfr_mul);
+			mpfr_sub(a->lo, a->lo, s->aux.hi, MPFR_RNDD);
+			mpfr_sub(a->hi, a->hi, s->aux.lo, MPFR_RNDU);
+			break;
+		case op_index:
+			if(mpfr_equal_p(b->lo, b->hi) && mpfr_integer_p(b->lo)) {
+				/* integer powers are monotonic on either side of zero */
+				mpfr_get_z(s->z[0], b->lo, MPFR_RNDN);
+
+				bool negative = mpz_sgn(s->z[0]) < 0;
+				bool straddles = mpfr_sgn(a->lo) < 0 && mpfr_sgn(a->hi) > 0;
+
+				if(negative && mpfr_sgn(a->lo) <= 0 && mpfr_sgn(a->hi) >= 0) {
+					a->known = false;
+					break;
+				}
+
+				corners(s, a, a, b, mpfr_pow);
+
+				/* even powers of a range straddling zero bottom out at zero */
+				if(straddles && mpz_even_p(s->z[0]))
+					mpfr_set_si(a->lo, 0, MPFR_RNDD);
+			}
+			else if(mpfr_sgn(a->lo) > 0)
+				corners(s, a, a, b, mpfr_pow);
+			else
+				a->known = false;
+			break;
+		case op_gt:
+		case op_gteq:
+		case op_lt:
+		case op_lteq:
+		case op_neq:
+		case op_eq:
+			{
+				/* equality => abs(a - b) < epsilon */
+				mpfr_sub(s->aux.lo, a->lo, b->hi, MPFR_RNDD);
+				mpfr_sub(s->aux.hi, a->hi, b->lo, MPFR_RNDU);
+
+				int equal = zero_state(s, &s->aux);
+				bool greater = mpfr_sgn(s->aux.lo) > 0;
+
+				if(equal < 0) {
+					a->known = false;
+					break;
+				}
+
+				switch(op) {
+					case op_gt:
+						set_si(a, !equal && greater);
+						break;
+					case op_gteq:
+						set_si(a, equal || greater);
+						break;
+					case op_lt:
+						set_si(a, !equal && !greater);
+						break;
+					case op_lteq:
+						set_si(a, equal || !greater);
+						break;
+					case op_neq:
+						set_si(a, !equal);
+						break;
+					case op_eq:
+						set_si(a, equal);
+						break;
+				}
+			}
+			break;
+		case op_band:
+		case op_bor:
+		case op_bxor:
+			/* bitwise operators round both sides to integers (which must be the same over the whole range) */
+			if(!get_integer(s, s->z[0], a, SYNGE_ROUND) || !get_integer(s, s->z[1], b, SYNGE_ROUND)) {
+				a->known = false;
+				break;
+			}
+
+			/* (get_integer() leaves the second side in z[1]) */
+			if(op == op_band)
+				mpz_and(s->z[0], s->z[0], s->z[1]);
+			else if(op == op_bor)
+				mpz_ior(s->z[0], s->z[0], s->z[1]);
+			else
+				mpz_xor(s->z[0], s->z[0], s->z[1]);
+
+			set_z(a, s->z[0]);
+			break;
+		case op_bshiftl:
+		case op_bshiftr:
+			/* bitshifting truncates both sides */
+			if(!get_integer(s, s->z[0], a, MPFR_RNDZ) || !get_integer(s, s->z[1], b, MPFR_RNDZ)) {
+				a->known = false;
+				break;
+			}
+
+			if(op == op_bshiftr)
+				mpz_neg(s->z[1], s->z[1]);
+
+			if(!shift(s, s->z[0], s->z[1])) {
+				a->known = false;
+				break;
+			}
+
+			set_z(a, s->z[0]);
+			break;
+		default:
+			a->known = false;
+			break;
+	}
+} /* ival_binary() */
+
+/* bound a compiled expression at the current working precision, returning false if it couldn't be bounded */
+static bool ival_run(struct ival_state *s, struct ival *stack) {
+	struct synge_vector *vector = s->vector;
+	struct ival *top = stack - 1;
+
+	int i;
+	for(i = 0; i < vector->length; i++) {
+		struct vec_instruction *in = &vector->code[i];
+
+		switch(in->kind) {
+			case vec_value:
+				top++;
+				mpfr_set(top->lo, vector->constants[in->op], MPFR_RNDD);
+				mpfr_set(top->hi, vector->constants[in->op], MPFR_RNDU);
+				top->known = true;
+				break;
+			case vec_unary:
+				if(top->known)
+					ival_unary(s, top, in->op);
+				break;
+			case vec_binary:
+				top--;
+				if(top->known && top[1].known)
+					ival_binary(s, top, top + 1, in->op);
+				else
+					top->known = false;
+				break;
+			case vec_func:
+				if(top->known)
+					ival_func(s, top, get_ival_func(in->func->name), in->op);
+				break;
+			case vec_select:
+				{
+					top -= 2;
+
+					/* only the chosen branch matters, as the engine never evaluates the other one */
+					int zero = top->known ? zero_state(s, top) : -1;
+					struct ival *chosen = zero ? top + 2 : top + 1;
+
+					if(zero < 0 || !chosen->known)
+						top->known = false;
+					else {
+						mpfr_set(top->lo, chosen->lo, MPFR_RNDD);
+						mpfr_set(top->hi, chosen->hi, MPFR_RNDU);
+					}
+				}
+				break;
+			case vec_column:
+			default:
+				/* there aren't any columns to read from */
+				top++;
+				top->known = false;
+				break;
+		}
+
+		/* infinities and undefined results are left to the engine */
+		if(top->known && (!mpfr_number_p(top->lo) || !mpfr_number_p(top->hi)))
+			top->known = false;
+	}
+
+	return top->known;
+} /* ival_run() */
+
+/* decimal places the result will be printed to (at most) */
+static int get_digits(struct synge_ctx *ctx) {
+	return ctx->settings.precision >= 0 ? ctx->settings.precision : SYNGE_MAX_PRECISION;
+} /* get_digits() */
+
+/* whether both ends of a range print the same way (so the exact result must too) */
+static bool same_digits(struct synge_ctx *ctx, struct ival *x) {
+	int precision = get_digits(ctx);
+
+	char *lo = malloc(lenprintf("%.*" SYNGE_FORMAT, precision, x->lo));
+	char *hi = malloc(lenprintf("%.*" SYNGE_FORMAT, precision, x->hi));
+
+	synge_sprintf(lo, "%.*" SYNGE_FORMAT, precision, x->lo);
+	synge_sprintf(hi, "%.*" SYNGE_FORMAT, precision, x->hi);
+
+	bool same = !strcmp(lo, hi);
+
+	free(lo);
+	free(hi);
+	return same;
+} /* same_digits() */
+
+static void ival_init(struct ival *x) {
+	mpfr_inits2(INTERVAL_START_PRECISION, x->lo, x->hi, NULL);
+	x->known = false;
+} /* ival_init() */
+
+static void ival_set_prec(struct ival *x, mpfr_prec_t precision) {
+	mpfr_set_prec(x->lo, precision);
+	mpfr_set_prec(x->hi, precision);
+} /* ival_set_prec() */
+
+static void ival_clear(struct ival *x) {
+	mpfr_clears(x->lo, x->hi, NULL);
+} /* ival_clear() */
+
+/* bound a compiled expression at increasing precisions until the bounds agree on every printed digit (storing the
+ * middle of the bounds), returning false if they never do below the engine's own precision */
+static bool bound(struct synge_ctx *ctx, struct synge_vector *vector, synge_t result) {
+	struct ival_state s;
+	struct ival *stack = malloc(vector->depth * sizeof(struct ival));
+
+	s.vector = vector;
+
+	mpfr_init2(s.epsilon, SYNGE_PRECISION);
+	mpfr_set_str(s.epsilon, SYNGE_EPSILON, 10, SYNGE_ROUND);
+
+	mpfr_inits2(INTERVAL_START_PRECISION, s.tmp[0], s.tmp[1], s.tmp[2], NULL);
+	mpfr_inits2(2 * SYNGE_PRECISION, s.big[0], s.big[1], NULL);
+	mpz_inits(s.z[0], s.z[1], NULL);
+	ival_init(&s.aux);
+
+	int i;
+	for(i = 0; i < vector->depth; i++)
+		ival_init(&stack[i]);
+
+	bool found = false;
+
+	/* start with enough bits for the printed digits (log2(10) is a bit less than 10/3) */
+	mpfr_prec_t precision = get_digits(ctx) * 10 / 3 + INTERVAL_GUARD_BITS;
+
+	if(precision < INTERVAL_START_PRECISION)
+		precision = INTERVAL_START_PRECISION;
+
+	for(; precision < SYNGE_PRECISION && !found; precision *= 2) {
+		for(i = 0; i < 3; i++)
+			mpfr_set_prec(s.tmp[i], precision);
+
+		ival_set_prec(&s.aux, precision);
+		for(i = 0; i < vector->depth; i++)
+			ival_set_prec(&stack[i], precision);
+
+		found = ival_run(&s, stack) && same_digits(ctx, &stack[0]);
+	}
+
+	if(found) {
+		mpfr_add(result, stack[0].lo, stack[0].hi, SYNGE_ROUND);
+		mpfr_div_2ui(result, result, 1, SYNGE_ROUND);
+	}
+
+	for(i = 0; i < vector->depth; i++)
+		ival_clear(&stack[i]);
+
+	ival_clear(&s.aux);
+	mpz_clears(s.z[0], s.z[1], NULL);
+	mpfr_clears(s.epsilon, s.tmp[0], s.tmp[1], s.tmp[2], s.big[0], s.big[1], NULL);
+
+	free(stack);
+	return found;
+} /* bound() */
+
+struct synge_err synge_ctx_compute_interval(struct synge_ctx *ctx, char *expression, synge_t *result) {
+	assert(ctx != NULL, "synge context must be initialised");
+
+	struct synge_err ecode;
+	struct synge_vector *vector = synge_ctx_vector_compile(ctx, expression, NULL, 0, &ecode);
+
+	/* anything which can't be compiled (or bounded) is left to the engine, which also reports any errors */
+	if(!vector)
+		return synge_internal_compute_string(ctx, expression, result, SYNGE_MAIN, 0, false);
+
+	bool found = bound(ctx, vector, *result);
+	synge_vector_free(vector);
+
+	if(!found)
+		return synge_internal_compute_string(ctx, expression, result, SYNGE_MAIN, 0, false);
+
+	/* finish up like any other successful evaluation (only a change to '_' changes the words) */
+	char *answer = answer_expression(expression);
+	if(answer_changes(ctx, answer))
+		ctx->publish.version++;
+
+	set_answer(ctx, answer, *result);
+	free(answer);
+
+	publish_words(ctx);
+
+	return to_error_code(SUCCESS, -1);
+} /* synge_ctx_compute_interval() */
+
+struct synge_err synge_compute_interval(char *expression, synge_t *result) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_compute_interval(default_ctx, expression, result);
+} /* synge_compute_interval() */
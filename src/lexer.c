@@ -20,6 +20,7 @@
 #include <stdarg.h>
 #include <math.h>
 #include <ctype.h>
+#include <errno.h>
 #include <string.h>
 
 #include "synge.h"
@@ -131,6 +132,76 @@ static bool isnum(char *string) {
 	return string != endptr || tmpcode.code == BASE_CHAR;
 } /* isnum() */
 
+/* plain decimal integer literals which fit in a long don't need to go through synge_strtofr() */
+static bool get_integer(char *string, long *integer, char **endptr) {
+	/* anything starting with 0 (apart from a lone 0) has a base prefix */
+	if(!isdigit(*string) || (*string == '0' && isalnum(string[1])))
+		return false;
+
+	errno = 0;
+	*integer = strtol(string, endptr, 10);
+
+	/* fractions and exponents need full precision */
+	return errno != ERANGE && !(**endptr && strchr(".eE@", **endptr));
+} /* get_integer() */
+
+/* largest decimal exponent kept exactly, beyond which a literal is left as a synge_t (even in exact mode) */
+#define RATIONAL_MAX_EXP 4096
+
+/* decimal literals are finite fractions, so (in exact mode) the literal synge_strtofr() read up to end is kept
+ * exactly, as long as it is a plain decimal with an optional exponent */
+static bool get_rational(char *string, char *end, mpq_t rational) {
+	/* anything starting with 0 (apart from a lone 0 or 0.) has a base prefix */
+	if(*string == '0' && isalnum(string[1]))
+		return false;
+
+	char *p = string, *mantissa = malloc(end - string + 1);
+	long digits = 0, scale = 0;
+	bool point = false;
+
+	/* the digits of the mantissa, with every fractional digit scaling it down */
+	for(; p < end && (isdigit(*p) || (*p == '.' && !point)); p++) {
+		if(*p == '.')
+			point = true;
+		else {
+			mantissa[digits++] = *p;
+			scale -= point;
+		}
+	}
+	mantissa[digits] = '\0';
+
+	if(p < end && (*p == 'e' || *p == 'E')) {
+		errno = 0;
+		long exponent = strtol(p + 1, &p, 10);
+
+		if(errno == ERANGE || labs(exponent) > RATIONAL_MAX_EXP)
+			p = NULL;
+		else
+			scale += exponent;
+	}
+
+	bool ret = digits && p == end;
+	if(ret) {
+		mpz_t power;
+		mpz_init(power);
+		mpz_ui_pow_ui(power, 10, labs(scale));
+
+		mpz_set_str(mpq_numref(rational), mantissa, 10);
+		if(scale < 0)
+			mpz_set(mpq_denref(rational), power);
+		else {
+			mpz_mul(mpq_numref(rational), mpq_numref(rational), power);
+			mpz_set_ui(mpq_denref(rational), 1);
+		}
+
+		mpq_canonicalize(rational);
+		mpz_clear(power);
+	}
+
+	free(mantissa);
+	return ret;
+} /* get_rational() */
+
 static char *get_expression_level(char *p, char end) {
 	int num_paren = 0, len = 0;
 	char *ret = NULL;
@@ -176,7 +247,7 @@ static void insert_mult(int pos, struct stack *infix_stack, int tp) {
 			case constant: /* pi<> == pi*<> */
 			case userword: /* a<> == a*<> */
 			case rparen: /* )<> == )*<> */
-				push_valstack("*", multop, false, NULL, pos + 1, infix_stack);
+				push_opstack(op_multiply, multop, pos + 1, infix_stack);
 				break;
 			default:
 				break;
@@ -186,9 +257,7 @@ static void insert_mult(int pos, struct stack *infix_stack, int tp) {
 
 /* this is a hand-written greedy lexer, not made using something sane like
  * lex or yacc ... apparently that is a bad idea. meh. it works. */
-struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
-	assert(synge_started == true, "synge must be initialised");
-
+struct synge_err synge_lex_string(struct synge_ctx *ctx, char *string, struct stack **infix_stack) {
 	_debug("--\nLexer\n--\n");
 	debug("Input: %s\n", string);
 
@@ -208,17 +277,25 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 		char *endptr = NULL;
 		char *word = get_word(string + i, SYNGE_WORD_CHARS, &endptr);
 
-		if(isnum(string+i)) {
-			synge_t *num = malloc(sizeof(synge_t)); /* allocate memory to be pushed onto the stack */
-			mpfr_init2(*num, SYNGE_PRECISION);
+		long integer;
+		char *intptr = NULL;
+
+		if(get_integer(string + i, &integer, &intptr)) {
+			tmpoffset = intptr - (string + i); /* update iterator to correct offset */
+
+			/* implied multiplication just like variables */
+			insert_mult(pos, *infix_stack, number);
+			push_intstack(integer, number, pos, *infix_stack); /* push given value */
+		} else if(isnum(string+i)) {
+			synge_t num; /* copied onto the stack once it has been parsed */
+			mpfr_init2(num, SYNGE_PRECISION);
 
 			/* set value */
 			char *endptr = NULL;
-			struct synge_err tmpcode = synge_strtofr(num, string + i, &endptr);
+			struct synge_err tmpcode = synge_strtofr(&num, string + i, &endptr);
 
 			if(!synge_is_success_code(tmpcode.code)) {
-				mpfr_clear(*num);
-				free(num);
+				mpfr_clear(num);
 				return to_error_code(tmpcode.code, pos);
 			}
 
@@ -226,30 +303,46 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 
 			/* implied multiplication just like variables */
 			insert_mult(pos, *infix_stack, number);
-			push_valstack(num, number, true, synge_clear, pos, *infix_stack); /* push given value */
+
+			mpq_t rational;
+			mpq_init(rational);
+
+			/* push given value */
+			if(ctx->settings.arithmetic == exact && get_rational(string + i, endptr, rational))
+				push_ratstack(rational, number, pos, *infix_stack);
+			else
+				push_numstack(num, number, pos, *infix_stack);
+
+			mpq_clear(rational);
 
 			/* error detection (done per number to ensure numbers are 163% correct) */
-			if(mpfr_nan_p(*num)) {
+			if(mpfr_nan_p(num)) {
+				mpfr_clear(num);
 				free(word);
 				return to_error_code(UNDEFINED, pos);
 			}
+
+			mpfr_clear(num);
 		} else if(word && get_special_num(word).name) {
-			synge_t *num = malloc(sizeof(synge_t)); /* allocate memory to be pushed onto the stack */
-			mpfr_init2(*num, SYNGE_PRECISION);
+			synge_t num; /* copied onto the stack once it has been set */
+			mpfr_init2(num, SYNGE_PRECISION);
 
 			struct synge_const stnum = get_special_num(word);
-			stnum.value(*num, SYNGE_ROUND);
+			stnum.value(num, SYNGE_ROUND, ctx);
 			tmpoffset = strlen(stnum.name); /* update iterator to correct offset */
 
 			/* implied multiplication just like variables */
 			insert_mult(pos, *infix_stack, constant);
-			push_valstack(num, constant, true, synge_clear, pos, *infix_stack); /* push given value */
+			push_numstack(num, constant, pos, *infix_stack); /* push given value */
 
 			/* error detection (done per number to ensure numbers are 163% correct) */
-			if(mpfr_nan_p(*num)) {
+			if(mpfr_nan_p(num)) {
+				mpfr_clear(num);
 				free(word);
 				return to_error_code(UNDEFINED, pos);
 			}
+
+			mpfr_clear(num);
 		} else if(get_op(string+i).str) {
 			int oplen = strlen(get_op(string+i).str);
 			int type;
@@ -282,6 +375,9 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 				case op_rparen:
 					type = rparen;
 					break;
+				case op_separator:
+					type = separator;
+					break;
 				case op_gt:
 				case op_gteq:
 				case op_lt:
@@ -313,7 +409,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 						}
 
 						/* push expression */
-						push_valstack(stripped, expression, true, NULL, pos, *infix_stack);
+						push_strstack(stripped, expression, true, pos, *infix_stack);
 						tmpoffset = strlen(expr);
 						free(expr);
 					}
@@ -334,7 +430,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 						}
 
 						/* push expression */
-						push_valstack(stripped, expression, true, NULL, pos, *infix_stack);
+						push_strstack(stripped, expression, true, pos, *infix_stack);
 						tmpoffset = strlen(expr);
 						free(expr);
 					}
@@ -364,7 +460,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 				case op_ca_increment:
 				case op_ca_decrement:
 					/* greedy lexer, like in C. In other words, a+++b === a++ + b. */
-					if(top_stack(*infix_stack) && !isop(top_stack(*infix_stack)->tp) && !isparen(top_stack(*infix_stack)->tp))
+					if(top_stack(*infix_stack) && !isop(top_stack(*infix_stack)->tp) && !isparen(top_stack(*infix_stack)->tp) && top_stack(*infix_stack)->tp != separator)
 						type = postmod;
 					else
 						type = premod;
@@ -380,7 +476,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 					return to_error_code(UNKNOWN_TOKEN, pos);
 			}
 
-			push_valstack(get_op(string+i).str, type, false, NULL, pos, *infix_stack); /* push operator onto stack */
+			push_opstack(get_op(string+i).tp, type, pos, *infix_stack); /* push operator onto stack */
 
 			/* if we are setting a function, we need to save the expression as a string since we don't want to evaluate it. */
 			if(get_op(string+i).tp == op_func_set) {
@@ -395,7 +491,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 					return to_error_code(EMPTY_BODY, pos);
 				}
 
-				push_valstack(stripped, expression, true, NULL, pos, *infix_stack);
+				push_strstack(stripped, expression, true, pos, *infix_stack);
 
 				tmpoffset = strlen(func_expr);
 				free(func_expr);
@@ -410,7 +506,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 			insert_mult(pos, *infix_stack, func);
 
 			struct synge_func *functionp = get_func(funcword); /* get the struct synge_func pointer, name, etc. */
-			push_valstack(functionp, func, false, NULL, pos, *infix_stack);
+			push_funcstack(functionp, func, pos, *infix_stack);
 
 			tmpoffset = strlen(functionp->name); /* update iterator to correct offset */
 			free(funcword);
@@ -426,7 +522,7 @@ struct synge_err synge_lex_string(char *string, struct stack **infix_stack) {
 				*stripped = '\0';
 			}
 
-			push_valstack(stripped, userword, true, NULL, pos, *infix_stack);
+			push_strstack(stripped, userword, true, pos, *infix_stack);
 			tmpoffset = strlen(word); /* update iterator to correct offset */
 		} else {
 			/* catchall -- unknown token */
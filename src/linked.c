@@ -13,8 +13,6 @@
 
 #include "linked.h"
 
-static void *pop_container = NULL;
-
 struct link_t *link_init(void) {
 	/* allocate new link */
 	struct link_t *new = malloc(sizeof(struct link_t));
@@ -30,18 +28,17 @@ struct link_t *link_init(void) {
 	new->chain->prev = NULL;
 	new->chain->next = NULL;
 
+	new->tail = new->chain;
+	new->pop_container = NULL;
+
 	return new;
 } /* link_init() */
 
 void link_free(struct link_t *link) {
 	if(!link) return;
 
-	/* initialise parent and current links */
-	struct link_node *parent = NULL, *current = link->chain;
-
-	/* go to last link */
-	while(current && current->next)
-		current = current->next;
+	/* initialise parent and current (last) links */
+	struct link_node *parent = NULL, *current = link->tail;
 
 	/* go backwards through links and free them */
 	while(current) {
@@ -61,27 +58,41 @@ void link_free(struct link_t *link) {
 
 	/* final setting to zero */
 	link->chain = NULL;
+	link->tail = NULL;
 	link->length = 0;
 
-	free(link);
-
 	/* freeing the pop_container (to keep valgrind happy) */
-	free(pop_container);
-	pop_container = NULL;
+	free(link->pop_container);
+	free(link);
 } /* link_free() */
 
 struct link_node *link_node_get(struct link_t *link, int index) {
 	if(!link || index >= link->length || index < 0)
 		return NULL;
 
-	/* initialise current and next links */
+	/* the last link is cached */
+	if(index == link->length - 1)
+		return link->tail;
+
+	/* initialise current link */
 	struct link_node *current = link->chain;
 
-	/* find link to append new link to */
-	while(index && current) {
-		/* get next link */
-		current = current->next;
-		index--;
+	/* walk from whichever end is closer */
+	if(index > link->length / 2) {
+		current = link->tail;
+		index = link->length - 1 - index;
+
+		while(index && current) {
+			/* get previous link */
+			current = current->prev;
+			index--;
+		}
+	} else {
+		while(index && current) {
+			/* get next link */
+			current = current->next;
+			index--;
+		}
 	}
 
 	/* index not found or link length is inaccurate */
@@ -111,6 +122,11 @@ int link_insert(struct link_t *link, int pos, void *content, size_t contentlen)
 	current->next->prev = current;
 	current->next->next = next;
 
+	if(next)
+		next->prev = current->next;
+	else
+		link->tail = current->next;
+
 	/* update length */
 	link->length++;
 	return 0;
@@ -152,6 +168,9 @@ int link_remove(struct link_t *link, int pos) {
 	/* link up orphan links, if they exist */
 	if(next)
 		next->prev = prev;
+	else
+		link->tail = prev;
+
 	if(prev)
 		prev->next = next;
 
@@ -179,12 +198,12 @@ void *link_pop(struct link_t *link, int pos) {
 	struct link_node *current = link_node_get(link, pos);
 
 	/* copy the link's content to a temporary variable */
-	pop_container = realloc(pop_container, current->contentlen);
-	memcpy(pop_container, current->content, current->contentlen);
+	link->pop_container = realloc(link->pop_container, current->contentlen);
+	memcpy(link->pop_container, current->content, current->contentlen);
 
 	/* delete the link and return its content */
 	link_remove(link, pos);
-	return pop_container;
+	return link->pop_container;
 } /* link_pop() */
 
 int link_truncate(struct link_t *link, int pos) {
@@ -208,11 +227,7 @@ int link_shorten(struct link_t *link, int num) {
 
 	/* initialise the current and parent links */
 	int left = num;
-	struct link_node *current = link->chain, *parent = link->chain->prev;
-
-	/* find the last link */
-	while(current && current->next)
-		current = current->next;
+	struct link_node *current = link->tail, *parent = NULL;
 
 	/* go backwards and delete the given number of links */
 	while(left && current) {
@@ -230,6 +245,7 @@ int link_shorten(struct link_t *link, int num) {
 		/* choose parent link and cut off freed link */
 		current = parent;
 		current->next = NULL;
+		link->tail = current;
 	}
 
 	/* not all links deleted */
@@ -53,8 +53,30 @@ static bool op_precedes(int op1, int op2) {
 	}
 } /* op_precedes() */
 
+/* find the builtin function with the same name which takes the given number of arguments */
+static struct synge_func *get_func_args(struct synge_func *function, int count) {
+	int i;
+	for(i = 0; func_list[i].name != NULL; i++)
+		if(!strcmp(func_list[i].name, function->name) && (func_list[i].args == count || (func_list[i].args == variadic && count > 0)))
+			return &func_list[i];
+
+	return NULL;
+} /* get_func_args() */
+
+/* push a function call with the given number of arguments (using the version of the function which takes that many) */
+static bool push_func(struct stack_cont function, int count, struct stack *rpn_stack) {
+	function.val.func = get_func_args(function.val.func, count);
+	function.count = count;
+
+	if(!function.val.func)
+		return false;
+
+	push_ststack(function, rpn_stack);
+	return true;
+} /* push_func() */
+
 /* my implementation of Dijkstra's really cool shunting-yard algorithm */
-struct synge_err synge_infix_parse(struct stack **infix_stack, struct stack **rpn_stack) {
+struct synge_err synge_infix_parse(struct synge_ctx *ctx, struct stack **infix_stack, struct stack **rpn_stack) {
 	struct stack *op_stack = malloc(sizeof(struct stack));
 
 	_debug("--\nParser\n--\n");
@@ -73,35 +95,64 @@ struct synge_err synge_infix_parse(struct stack **infix_stack, struct stack **rp
 		switch(stackp.tp) {
 			case number:
 			case constant:
-				/* nothing to do, just push it onto the temporary stack */
-				push_valstack(num_dup(SYNGE_T(stackp.val)), stackp.tp, true, synge_clear, pos, *rpn_stack);
-				break;
 			case expression:
 			case userword:
-				/* do nothing, just push it onto the stack */
-				push_valstack(str_dup(stackp.val), stackp.tp, true, NULL, pos, *rpn_stack);
+				/* nothing to do, just move it onto the temporary stack */
+				move_ststack(&(*infix_stack)->content[i], *rpn_stack);
 				break;
 			case lparen:
 			case func:
 				/* again, nothing to do, push it onto the stack */
 				push_ststack(stackp, op_stack);
 				break;
+			case separator:
+				{
+					/* an argument can't be empty */
+					if(!i || (*infix_stack)->content[i - 1].tp == lparen || (*infix_stack)->content[i - 1].tp == separator) {
+						free_stackm(infix_stack, &op_stack, rpn_stack);
+						return to_error_code(FUNCTION_WRONG_ARGC, pos);
+					}
+
+					/* finish off the argument, leaving its lparen (which counts the arguments) on the stack */
+					while(stack_size(op_stack) && top_stack(op_stack)->tp != lparen)
+						push_ststack(*pop_stack(op_stack), *rpn_stack);
+
+					/* outside of a bracket, the extra value will be caught when evaluating */
+					if(stack_size(op_stack))
+						top_stack(op_stack)->count++;
+				}
+				break;
 			case rparen:
 				{
 					/* keep popping and pushing until you find an lparen, which isn't to be pushed  */
-					int found = false;
+					int found = false, count = 0;
 					while(stack_size(op_stack)) {
 						struct stack_cont *tmpstackp = pop_stack(op_stack);
 						if(tmpstackp->tp == lparen) {
 							found = true;
+							count = tmpstackp->count;
 							break;
 						}
 						push_ststack(*tmpstackp, *rpn_stack); /* push it onto the stack */
 					}
 
+					/* an empty bracket has no arguments, and the last argument can't be empty */
+					if(i && (*infix_stack)->content[i - 1].tp == lparen)
+						count = 0;
+					else if(i && (*infix_stack)->content[i - 1].tp == separator) {
+						free_stackm(infix_stack, &op_stack, rpn_stack);
+						return to_error_code(FUNCTION_WRONG_ARGC, pos);
+					}
+
 					/* push function pointer to ouput (if there is one) */
-					if(top_stack(op_stack) && top_stack(op_stack)->tp == func)
-						push_ststack(*pop_stack(op_stack), *rpn_stack);
+					if(found && top_stack(op_stack) && top_stack(op_stack)->tp == func) {
+						struct stack_cont function = *pop_stack(op_stack);
+
+						if(!push_func(function, count, *rpn_stack)) {
+							free_stackm(infix_stack, &op_stack, rpn_stack);
+							return to_error_code(FUNCTION_WRONG_ARGC, function.position);
+						}
+					}
 
 					/* if no lparen was found, this is an unmatched right bracket*/
 					if(!found) {
@@ -122,28 +173,23 @@ struct synge_err synge_infix_parse(struct stack **infix_stack, struct stack **rp
 						return to_error_code(INVALID_LEFT_OPERAND, pos);
 					}
 
-					push_valstack(str_dup(tmpstackp->val), setword, true, NULL, tmpstackp->position, *rpn_stack);
+					move_ststack(tmpstackp, *rpn_stack);
+					top_stack(*rpn_stack)->tp = setword;
 					push_ststack(stackp, *rpn_stack);
 				}
 				break;
 			case postmod:
 				{
-					if(top_stack(*rpn_stack) && top_stack(*rpn_stack)->tp == userword) {
-						struct stack_cont *pop = pop_stack(*rpn_stack);
-						push_valstack(pop->val, setword, true, NULL, pop->position, *rpn_stack);
-					}
+					if(top_stack(*rpn_stack) && top_stack(*rpn_stack)->tp == userword)
+						top_stack(*rpn_stack)->tp = setword;
 
 					push_ststack(stackp, *rpn_stack);
 				}
 				break;
 			case setop:
 			case modop:
-				{
-					if(top_stack(*rpn_stack) && top_stack(*rpn_stack)->tp == userword) {
-						struct stack_cont *pop = pop_stack(*rpn_stack);
-						push_valstack(pop->val, setword, true, NULL, pop->position, *rpn_stack);
-					}
-				}
+				if(top_stack(*rpn_stack) && top_stack(*rpn_stack)->tp == userword)
+					top_stack(*rpn_stack)->tp = setword;
 				/* pass-through */
 			case preop:
 			case elseop:
@@ -182,11 +228,22 @@ struct synge_err synge_infix_parse(struct stack **infix_stack, struct stack **rp
 		if(stackp.tp == lparen ||
 		   stackp.tp == rparen) {
 			/* if there is a left or right bracket, there is an unmatched left bracket */
-			if(active_settings.strict >= strict) {
+			if(ctx->settings.strict >= strict) {
 				free_stackm(infix_stack, &op_stack, rpn_stack);
 				return to_error_code(UNMATCHED_LEFT_PARENTHESIS, pos);
 			}
-			else continue;
+
+			/* the arguments of an unclosed function call still count */
+			if(stackp.tp == lparen && top_stack(op_stack) && top_stack(op_stack)->tp == func) {
+				struct stack_cont function = *pop_stack(op_stack);
+
+				if(!push_func(function, stackp.count, *rpn_stack)) {
+					free_stackm(infix_stack, &op_stack, rpn_stack);
+					return to_error_code(FUNCTION_WRONG_ARGC, function.position);
+				}
+			}
+
+			continue;
 		}
 
 		push_ststack(stackp, *rpn_stack);
@@ -18,6 +18,7 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
+#include "synge.h"
 #include "stack.h"
 
 void init_stack(struct stack *s) {
@@ -26,33 +27,94 @@ void init_stack(struct stack *s) {
 	s->top = -1;
 } /* init_stack() */
 
-void push_ststack(struct stack_cont con, struct stack *s) {
-	if(s->top + 1 >= s->size) /* if stack is full */
-		s->content = realloc(s->content, ++s->size * sizeof(struct stack_cont));
+static struct stack_cont *push_slot(int tp, int tag, int pos, struct stack *s) {
+	if(s->top + 1 >= s->size) { /* if stack is full */
+		s->size = s->size ? s->size * 2 : 8;
+		s->content = realloc(s->content, s->size * sizeof(struct stack_cont));
+	}
 
 	s->top++;
-	s->content[s->top] = (struct stack_cont) {
-		.val = con.val,
-		.tp = con.tp,
-		.tofree = con.tofree,
-		.freefunc = con.freefunc,
-		.position = con.position
-	};
+	s->content[s->top].tp = tp;
+	s->content[s->top].tag = tag;
+	s->content[s->top].position = pos;
+	s->content[s->top].count = 1;
+	return &s->content[s->top];
+} /* push_slot() */
+
+void push_ststack(struct stack_cont con, struct stack *s) {
+	struct stack_cont *slot = push_slot(con.tp, con.tag, con.position, s);
+
+	/* mpfr_t is safe to copy bytewise, since the limbs live elsewhere */
+	slot->val = con.val;
+	slot->count = con.count;
 } /* push_ststack() */
 
-void push_valstack(void *val, int tp, int tofree, void (*freefunc)(void *), int pos, struct stack *s) {
-	if(s->top + 1 >= s->size) /* if stack is full */
-		s->content = realloc(s->content, ++s->size * sizeof(struct stack_cont));
+void move_ststack(struct stack_cont *con, struct stack *s) {
+	push_ststack(*con, s);
 
-	s->top++;
-	s->content[s->top] = (struct stack_cont) {
-		.val = val,
-		.tp = tp,
-		.tofree = tofree,
-		.freefunc = freefunc,
-		.position = pos
-	};
-} /* push_valstack() */
+	/* the value now belongs to the new stack */
+	if(con->tag == tag_string)
+		con->tag = tag_span;
+	else if(con->tag == tag_number || con->tag == tag_bigint || con->tag == tag_rational)
+		con->tag = tag_none;
+} /* move_ststack() */
+
+void push_numstack(synge_t num, int tp, int pos, struct stack *s) {
+	/* small integers are stored inline (negative zero needs a synge_t to keep its sign) */
+	if(mpfr_integer_p(num) && mpfr_fits_slong_p(num, SYNGE_ROUND) && !(mpfr_zero_p(num) && mpfr_signbit(num))) {
+		push_intstack(mpfr_get_si(num, SYNGE_ROUND), tp, pos, s);
+		return;
+	}
+
+	struct stack_cont *slot = push_slot(tp, tag_number, pos, s);
+
+	mpfr_init2(slot->val.num, SYNGE_PRECISION);
+	mpfr_set(slot->val.num, num, SYNGE_ROUND);
+} /* push_numstack() */
+
+void push_intstack(long num, int tp, int pos, struct stack *s) {
+	struct stack_cont *slot = push_slot(tp, tag_integer, pos, s);
+	slot->val.integer = num;
+} /* push_intstack() */
+
+void push_bigstack(mpz_t num, int tp, int pos, struct stack *s) {
+	/* integers which fit in a long are still stored inline */
+	if(mpz_fits_slong_p(num)) {
+		push_intstack(mpz_get_si(num), tp, pos, s);
+		return;
+	}
+
+	struct stack_cont *slot = push_slot(tp, tag_bigint, pos, s);
+	mpz_init_set(slot->val.bigint, num);
+} /* push_bigstack() */
+
+void push_ratstack(mpq_t num, int tp, int pos, struct stack *s) {
+	/* whole fractions are stored as integers */
+	if(!mpz_cmp_ui(mpq_denref(num), 1)) {
+		push_bigstack(mpq_numref(num), tp, pos, s);
+		return;
+	}
+
+	struct stack_cont *slot = push_slot(tp, tag_rational, pos, s);
+
+	mpq_init(slot->val.rational);
+	mpq_set(slot->val.rational, num);
+} /* push_ratstack() */
+
+void push_strstack(char *str, int tp, bool own, int pos, struct stack *s) {
+	struct stack_cont *slot = push_slot(tp, own ? tag_string : tag_span, pos, s);
+	slot->val.str = str;
+} /* push_strstack() */
+
+void push_funcstack(struct synge_func *func, int tp, int pos, struct stack *s) {
+	struct stack_cont *slot = push_slot(tp, tag_func, pos, s);
+	slot->val.func = func;
+} /* push_funcstack() */
+
+void push_opstack(int op, int tp, int pos, struct stack *s) {
+	struct stack_cont *slot = push_slot(tp, tag_op, pos, s);
+	slot->val.op = op;
+} /* push_opstack() */
 
 struct stack_cont *pop_stack(struct stack *s) {
 	struct stack_cont *ret = NULL;
@@ -72,18 +134,83 @@ struct stack_cont *top_stack(struct stack *s) {
 	return ret;
 } /* top_stack() */
 
+void get_numstack(struct stack_cont *s, synge_t num) {
+	switch(s->tag) {
+		case tag_integer:
+			mpfr_set_si(num, s->val.integer, SYNGE_ROUND);
+			break;
+		case tag_bigint:
+			mpfr_set_z(num, s->val.bigint, SYNGE_ROUND);
+			break;
+		case tag_rational:
+			mpfr_set_q(num, s->val.rational, SYNGE_ROUND);
+			break;
+		default:
+			mpfr_set(num, s->val.num, SYNGE_ROUND);
+			break;
+	}
+} /* get_numstack() */
+
+void get_bigstack(struct stack_cont *s, mpz_t num, mpfr_rnd_t round) {
+	switch(s->tag) {
+		case tag_integer:
+			mpz_set_si(num, s->val.integer);
+			break;
+		case tag_bigint:
+			mpz_set(num, s->val.bigint);
+			break;
+		case tag_rational:
+			/* round the same way as the equivalent synge_t would be */
+			{
+				synge_t tmp;
+				mpfr_init2(tmp, SYNGE_PRECISION);
+				mpfr_set_q(tmp, s->val.rational, SYNGE_ROUND);
+				mpfr_get_z(num, tmp, round);
+				mpfr_clear(tmp);
+			}
+			break;
+		default:
+			mpfr_get_z(num, s->val.num, round);
+			break;
+	}
+} /* get_bigstack() */
+
+void get_ratstack(struct stack_cont *s, mpq_t num) {
+	switch(s->tag) {
+		case tag_integer:
+			mpq_set_si(num, s->val.integer, 1);
+			break;
+		case tag_bigint:
+			mpq_set_z(num, s->val.bigint);
+			break;
+		default:
+			mpq_set(num, s->val.rational);
+			break;
+	}
+} /* get_ratstack() */
+
 void free_stack_cont(struct stack_cont *s) {
 	if(!s)
 		return;
 
-	if(s->tofree) {
-		if(s->freefunc && s->val)
-			s->freefunc(s->val);
-
-		free(s->val);
-		s->val = NULL;
+	switch(s->tag) {
+		case tag_number:
+			mpfr_clear(s->val.num);
+			break;
+		case tag_bigint:
+			mpz_clear(s->val.bigint);
+			break;
+		case tag_rational:
+			mpq_clear(s->val.rational);
+			break;
+		case tag_string:
+			free(s->val.str);
+			break;
+		default:
+			break;
 	}
 
+	s->tag = tag_none;
 	s->position = -1;
 } /* free_stack_cont() */
 
@@ -91,10 +218,10 @@ void free_stack(struct stack *s) {
 	if(!s || !s->content)
 		return;
 
+	/* popped items have already been freed (or moved) by whoever popped them */
 	int i;
-	for(i = 0; i < s->size; i++)
-		if(s->content[i].tofree)
-			free_stack_cont(&s->content[i]);
+	for(i = 0; i <= s->top; i++)
+		free_stack_cont(&s->content[i]);
 
 	free(s->content);
 	s->content = NULL;
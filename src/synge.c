@@ -15,6 +15,8 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
@@ -22,6 +24,8 @@
 #include <ctype.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "synge.h"
 #include "version.h"
@@ -29,9 +33,10 @@
 #include "global.h"
 #include "stack.h"
 #include "ohmic.h"
-#include "linked.h"
 
-#define SYNGE_HM_SIZE 42
+#if defined(_WINDOWS)
+#	include <windows.h>
+#endif
 
 /* for windows, define strcasecmp and strncasecmp */
 #if defined(_WINDOWS)
@@ -61,51 +66,318 @@ int strncasecmp(char *s1, char *s2, size_t n) {
 } /* strncasecmp() */
 #endif /* _WINDOWS */
 
-int synge_get_precision(synge_t num) {
+/* the given number of significant digits of a number (and a sign), which go in buf if they fit */
+static char *get_digits(synge_t num, long count, char *buf, size_t size, mpfr_exp_t *point) {
+	if((size_t) count + 2 > size)
+		buf = malloc(count + 2);
+
+	mpfr_get_str(buf, point, 10, count, num, MPFR_RNDN);
+	return buf;
+} /* get_digits() */
+
+/* the digits of a regular number rounded to the given decimal places, where the number is 0.<digits> * 10^point.
+ * they go in buf (which must fit at least a few digits) if they fit, otherwise they are allocated. */
+static char *round_digits(synge_t num, int places, char *buf, size_t size, mpfr_exp_t *point) {
+	/* the digits before the decimal point can't be more than this (log10(2) is between 0.30102999 and 0.30103) */
+	mpfr_exp_t exp = mpfr_get_exp(num);
+	long guess = (long) floor(exp * (exp < 0 ? 0.30102999 : 0.30103)) + 1;
+
+	if(guess + places >= 2) {
+		char *digits = get_digits(num, guess + places, buf, size, point);
+		if(*point == guess)
+			return digits;
+
+		/* the guess was too high, so round again at the right place (unless the number is too small for that) */
+		mpfr_exp_t first = *point;
+		if(first + places >= 2) {
+			char *again = get_digits(num, first + places, NULL, 0, point);
+
+			/* which was already done, if rounding carried into a new digit the first time */
+			if(*point < first) {
+				free(again);
+				*point = first;
+				return digits;
+			}
+
+			if(digits != buf)
+				free(digits);
+			return again;
+		}
+
+		if(digits != buf)
+			free(digits);
+	}
+
+	/* |num| < 10^(1 - places), so it rounds to a single digit (or 10), which is found directly */
+	mpz_t power, rounded;
+	mpz_inits(power, rounded, NULL);
+
+	synge_t scaled;
+	mpfr_init2(scaled, mpfr_get_prec(num) + 3 * places);
+
+	/* the product is exact, so it is only rounded once */
+	mpz_ui_pow_ui(power, 10, places);
+	mpfr_mul_z(scaled, num, power, MPFR_RNDN);
+	mpfr_get_z(rounded, scaled, MPFR_RNDN);
+	mpz_abs(rounded, rounded);
+
+	mpz_get_str(buf, 10, rounded);
+	*point = (mpfr_exp_t) strlen(buf) - places;
+
+	mpfr_clear(scaled);
+	mpz_clears(power, rounded, NULL);
+	return buf;
+} /* round_digits() */
+
+/* the decimal places of rounded digits which aren't trailing zeros */
+static int trim_places(char *digits, mpfr_exp_t point, int places) {
+	long length = strlen(digits);
+
+	if(places > length - point)
+		places = length - point > 0 ? length - point : 0;
+
+	while(places > 0 && (point + places - 1 < 0 || digits[point + places - 1] == '0'))
+		places--;
+
+	return places;
+} /* trim_places() */
+
+/* large enough for the digits of most numbers, so they don't need to be allocated */
+#define DIGITS_SIZE 256
+
+int synge_ctx_get_precision(struct synge_ctx *ctx, synge_t num) {
 	/* use the current settings' precision if given */
-	if(active_settings.precision >= 0)
-		return active_settings.precision;
+	if(ctx->settings.precision >= 0)
+		return ctx->settings.precision;
 
-	/* printf knows how to fix rounding errors */
-	char *tmp = malloc(lenprintf("%.*" SYNGE_FORMAT, SYNGE_MAX_PRECISION, num));
-	synge_sprintf(tmp, "%.*" SYNGE_FORMAT, SYNGE_MAX_PRECISION, num);
+	/* zero has no decimals, and nothing else which isn't regular has digits */
+	if(!mpfr_regular_p(num))
+		return mpfr_zero_p(num) ? 0 : SYNGE_MAX_PRECISION;
 
-	/* move pointer to end and set precision to maximum */
-	char *p = tmp + strlen(tmp) - 1;
-	int precision = SYNGE_MAX_PRECISION;
+	char buf[DIGITS_SIZE];
+	mpfr_exp_t point;
 
-	/* find all trailing zeros */
-	while(*p-- == '0')
-		precision--;
+	/* the digits to the maximum precision, without trailing zeros */
+	char *digits = round_digits(num, SYNGE_MAX_PRECISION, buf, sizeof(buf), &point);
+	int precision = trim_places(digits + (*digits == '-'), point, SYNGE_MAX_PRECISION);
+
+	if(digits != buf)
+		free(digits);
 
-	free(tmp);
 	return precision;
-} /* get_precision() */
+} /* synge_ctx_get_precision() */
 
-static char *get_trace(struct link_t *link) {
-	char *ret = NULL, *current = NULL;
-	struct link_iter *ii = link_iter_init(link);
+enum {
+	MODULE,
+	CONDITIONAL,
+	FUNCTION,
+	ELIDED
+};
 
-	ret = malloc(1);
-	*ret = '\0';
+static int synge_call_type(char *caller) {
+	char first = *caller;
+	char last = *(caller + strlen(caller) - 1);
 
-	int len = 0;
-	do {
-		/* get current function traceback information */
-		current = (char *) ii->content;
-		if(!current)
-			continue;
+	/* conditionals are SYNGE_IF and SYNGE_ELSE */
+	if(!strcmp(caller, SYNGE_IF) || !strcmp(caller, SYNGE_ELSE))
+		return CONDITIONAL;
 
-		len += strlen(current);
+	/* modules are in the format <____> */
+	else if(first == '<' && last == '>')
+		return MODULE;
 
-		/* append current function traceback */
-		ret = realloc(ret, len + 1);
-		sprintf(ret, "%s%s", ret, current);
-	} while(!link_iter_next(ii));
+	/* resort to function */
+	return FUNCTION;
+} /* synge_call_type() */
 
-	link_iter_free(ii);
-	return ret;
-} /* get_trace() */
+/* add a level to the traceback, returning its index */
+int trace_push(struct synge_ctx *ctx, char *caller, int position) {
+	struct synge_trace *trace = &ctx->traceback_list;
+
+	if(trace->length >= trace->size) {
+		trace->size = trace->size ? trace->size * 2 : 16;
+		trace->frames = realloc(trace->frames, trace->size * sizeof(struct synge_frame));
+	}
+
+	struct synge_frame *frame = &trace->frames[trace->length];
+
+	frame->caller = caller;
+	frame->position = position;
+	frame->kind = synge_call_type(caller);
+	frame->owned = false;
+
+	return trace->length++;
+} /* trace_push() */
+
+/* the caller's name is about to be freed along with its stack, so keep a copy for the traceback */
+void trace_keep(struct synge_ctx *ctx, int index) {
+	struct synge_frame *frame = &ctx->traceback_list.frames[index];
+
+	if(!frame->owned) {
+		frame->caller = str_dup(frame->caller);
+		frame->owned = true;
+	}
+} /* trace_keep() */
+
+/* remove all levels from the given index onwards */
+void trace_truncate(struct synge_ctx *ctx, int index) {
+	struct synge_trace *trace = &ctx->traceback_list;
+
+	while(trace->length > index) {
+		struct synge_frame *frame = &trace->frames[--trace->length];
+
+		if(frame->owned)
+			free(frame->caller);
+	}
+} /* trace_truncate() */
+
+/* fold the level after the given index into it, so it stands for the tail calls elided between them */
+void trace_elide(struct synge_ctx *ctx, int index) {
+	struct synge_frame *frame = &ctx->traceback_list.frames[index];
+
+	if(frame->kind != ELIDED) {
+		if(frame->owned)
+			free(frame->caller);
+
+		frame->caller = NULL;
+		frame->owned = false;
+		frame->kind = ELIDED;
+		frame->position = 1;
+	}
+
+	frame->position++;
+	trace_truncate(ctx, index + 1);
+} /* trace_elide() */
+
+struct synge_cancel {
+	pthread_mutex_t lock;
+	bool set;
+};
+
+struct synge_cancel *synge_cancel_new(void) {
+	struct synge_cancel *token = malloc(sizeof(struct synge_cancel));
+
+	pthread_mutex_init(&token->lock, NULL);
+	token->set = false;
+	return token;
+} /* synge_cancel_new() */
+
+void synge_cancel_free(struct synge_cancel *token) {
+	pthread_mutex_destroy(&token->lock);
+	free(token);
+} /* synge_cancel_free() */
+
+static void cancel_store(struct synge_cancel *token, bool set) {
+	pthread_mutex_lock(&token->lock);
+	token->set = set;
+	pthread_mutex_unlock(&token->lock);
+} /* cancel_store() */
+
+void synge_cancel_set(struct synge_cancel *token) {
+	cancel_store(token, true);
+} /* synge_cancel_set() */
+
+void synge_cancel_reset(struct synge_cancel *token) {
+	cancel_store(token, false);
+} /* synge_cancel_reset() */
+
+bool synge_cancel_is_set(struct synge_cancel *token) {
+	pthread_mutex_lock(&token->lock);
+	bool set = token->set;
+	pthread_mutex_unlock(&token->lock);
+
+	return set;
+} /* synge_cancel_is_set() */
+
+/* monotonic time in seconds */
+static double get_time(void) {
+#if defined(_WINDOWS)
+	return GetTickCount64() / 1e3;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+} /* get_time() */
+
+/* start the clock for a new evaluation */
+void watch_start(struct synge_ctx *ctx) {
+	ctx->watch.code = SUCCESS;
+	ctx->watch.used = (struct synge_budget) {0, 0, 0};
+	ctx->watch.deadline = ctx->settings.timeout > 0 ? get_time() + ctx->settings.timeout / 1e3 : 0;
+} /* watch_start() */
+
+/* check whether the current evaluation has been cancelled or has run out of time (once it has, it stays that way) */
+int watch_check(struct synge_ctx *ctx) {
+	struct synge_watch *watch = &ctx->watch;
+
+	if(watch->code != SUCCESS)
+		return watch->code;
+
+	if(watch->cancel && synge_cancel_is_set(watch->cancel))
+		watch->code = CANCELLED;
+	else if(watch->deadline > 0 && get_time() >= watch->deadline)
+		watch->code = TIMEOUT;
+
+	return watch->code;
+} /* watch_check() */
+
+/* a caller-supplied buffer which text is appended to -- the full length is counted even once it has run out of room */
+struct msg_buf {
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static void msg_append(struct msg_buf *out, char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+
+	/* only write while there is room (keeping the null terminator) */
+	int add = vsnprintf(out->len < out->size ? out->buf + out->len : NULL, out->len < out->size ? out->size - out->len : 0, format, ap);
+	va_end(ap);
+
+	if(add > 0)
+		out->len += add;
+} /* msg_append() */
+
+static void msg_putc(struct msg_buf *out, char c) {
+	/* only write while there is room (keeping the null terminator) */
+	if(out->len + 1 < out->size) {
+		out->buf[out->len] = c;
+		out->buf[out->len + 1] = '\0';
+	}
+
+	out->len++;
+} /* msg_putc() */
+
+static void append_trace(struct synge_ctx *ctx, struct msg_buf *out) {
+	char *format = NULL;
+	int i;
+
+	for(i = 0; i < ctx->traceback_list.length; i++) {
+		struct synge_frame *frame = &ctx->traceback_list.frames[i];
+
+		/* get traceback format from caller type */
+		switch(frame->kind) {
+			case MODULE:
+				format = SYNGE_TRACEBACK_MODULE;
+				break;
+			case CONDITIONAL:
+				format = SYNGE_TRACEBACK_CONDITIONAL;
+				break;
+			case ELIDED:
+				msg_append(out, SYNGE_TRACEBACK_ELIDED, frame->position);
+				continue;
+			case FUNCTION:
+			default:
+				format = SYNGE_TRACEBACK_FUNCTION;
+				break;
+		}
+
+		msg_append(out, format, frame->caller, frame->position);
+	}
+} /* append_trace() */
 
 static char *get_error_type(struct synge_err error) {
 	switch(error.code) {
@@ -140,6 +412,11 @@ static char *get_error_type(struct synge_err error) {
 			return "NameError";
 			break;
 		case TOO_DEEP:
+		case TIMEOUT:
+		case CANCELLED:
+		case STEP_LIMIT:
+		case MEMORY_LIMIT:
+		case CALL_LIMIT:
 		default:
 			return "OtherError";
 			break;
@@ -148,7 +425,7 @@ static char *get_error_type(struct synge_err error) {
 	return "IHaveNoIdea";
 } /* get_error_type() */
 
-char *synge_error_msg(struct synge_err error) {
+static char *get_error_text(struct synge_err error) {
 	char *msg = NULL;
 
 	/* get correct printf string */
@@ -222,250 +499,624 @@ char *synge_error_msg(struct synge_err error) {
 			cheeky("We have delved too deep and too greedily and have awoken a being of shadow, flame and infinite loops.\n");
 			msg = "Delved too deep";
 			break;
+		case TIMEOUT:
+			cheeky("The answer is 42. Well, it would have been, if you'd waited seven and a half million years.\n");
+			msg = "Evaluation took too long";
+			break;
+		case CANCELLED:
+			msg = "Evaluation was cancelled";
+			break;
+		case STEP_LIMIT:
+			msg = "Evaluation took too many steps";
+			break;
+		case MEMORY_LIMIT:
+			msg = "Evaluation used too much memory";
+			break;
+		case CALL_LIMIT:
+			msg = "Evaluation made too many function calls";
+			break;
 		default:
 			cheeky("Synge dun goofed.\n");
 			msg = "An unknown error has occured";
 			break;
 	}
 
-	free(error_msg_container);
+	return msg;
+} /* get_error_text() */
 
-	char *trace = NULL;
+/* format an error message into a buffer, returning the full length of the message (like snprintf) */
+static int format_error(struct synge_ctx *ctx, struct synge_err error, char *msg, char *buf, size_t size) {
+	struct msg_buf out = {buf, size, 0};
 
-	/* allocates memory and sets error_msg_container to correct (printf'd) string */
-	switch(active_settings.error) {
-		case traceback:
-			if(!synge_is_success_code(error.code)) {
-				char *fulltrace = get_trace(traceback_list);
+	if(size > 0)
+		*buf = '\0';
 
-				trace = malloc(lenprintf(SYNGE_TRACEBACK_FORMAT, fulltrace, get_error_type(error), msg));
-				sprintf(trace, SYNGE_TRACEBACK_FORMAT, fulltrace, get_error_type(error), msg);
-
-				free(fulltrace);
-			}
-		case position:
-			if(error.position > 0) {
-				error_msg_container = malloc(lenprintf("%s @ %d", trace ? trace : msg, error.position));
-				sprintf(error_msg_container, "%s @ %d", trace ? trace : msg, error.position);
-			} else {
-		case simple:
-				error_msg_container = malloc(lenprintf("%s", trace ? trace : msg));
-				sprintf(error_msg_container, "%s", trace ? trace : msg);
-			}
-			break;
+	/* the traceback (if there is one) leads up to the error */
+	if(ctx->settings.error == traceback && !synge_is_success_code(error.code)) {
+		msg_append(&out, SYNGE_TRACEBACK_HEADER);
+		append_trace(ctx, &out);
+		msg_append(&out, SYNGE_TRACEBACK_ERROR, get_error_type(error), msg);
 	}
+	else
+		msg_append(&out, "%s", msg);
 
-	free(trace);
+	if(ctx->settings.error != simple && error.position > 0)
+		msg_append(&out, " @ %d", error.position);
 
 	debug("position of error: %d\n", error.position);
-	return error_msg_container;
-} /* get_error_msg() */
+	return out.len;
+} /* format_error() */
 
-char *synge_error_msg_pos(int code, int pos) {
-	return synge_error_msg(to_error_code(code, pos));
-} /* get_error_msg_pos() */
+int synge_ctx_format_error(struct synge_ctx *ctx, struct synge_err error, char *buf, size_t size) {
+	return format_error(ctx, error, get_error_text(error), buf, size);
+} /* synge_ctx_format_error() */
 
-enum {
-	MODULE,
-	CONDITIONAL,
-	FUNCTION
-};
+int synge_ctx_format_number(struct synge_ctx *ctx, synge_t num, char *buf, size_t size) {
+	/* there are no digits to work out for anything which isn't regular */
+	if(!mpfr_regular_p(num))
+		return synge_snprintf(buf, size, "%.*" SYNGE_FORMAT, synge_ctx_get_precision(ctx, num), num);
 
-static int synge_call_type(char *caller) {
-	char first = *caller;
-	char last = *(caller + strlen(caller) - 1);
+	struct msg_buf out = {buf, size, 0};
 
-	/* conditionals are SYNGE_IF and SYNGE_ELSE */
-	if(!strcmp(caller, SYNGE_IF) || !strcmp(caller, SYNGE_ELSE))
-		return CONDITIONAL;
+	if(size > 0)
+		*buf = '\0';
 
-	/* modules are in the format <____> */
-	else if(first == '<' && last == '>')
-		return MODULE;
+	char local[DIGITS_SIZE];
+	mpfr_exp_t i, point;
 
-	/* resort to function */
-	return FUNCTION;
-} /* synge_call_type() */
+	int places = ctx->settings.precision >= 0 ? ctx->settings.precision : SYNGE_MAX_PRECISION;
+	char *digits = round_digits(num, places, local, sizeof(local), &point), *d = digits + (*digits == '-');
+	long length = strlen(d);
+
+	/* dynamic precision drops the trailing zeros */
+	if(ctx->settings.precision < 0)
+		places = trim_places(d, point, places);
+
+	/* written the same way as "%.*Rf" */
+	if(mpfr_signbit(num))
+		msg_putc(&out, '-');
+
+	if(point <= 0)
+		msg_putc(&out, '0');
+
+	for(i = 0; i < point; i++)
+		msg_putc(&out, i < length ? d[i] : '0');
+
+	if(places > 0)
+		msg_putc(&out, '.');
+
+	for(i = point; i < point + places; i++)
+		msg_putc(&out, i >= 0 && i < length ? d[i] : '0');
 
-struct synge_err synge_internal_compute_string(char *string, synge_t *result, char *caller, int position) {
-	assert(synge_started == true, "synge must be initialised");
+	if(digits != local)
+		free(digits);
 
-	/* backup variable and function hashmaps are
-	 * used to "roll back" the maps to a known good
-	 * state if an error occurs */
-	struct ohm_t *backup_var = ohm_dup(variable_list);
-	struct ohm_t *backup_func = ohm_dup(expression_list);
+	return out.len;
+} /* synge_ctx_format_number() */
 
-	/* duplicate all variables */
-	struct ohm_iter i = ohm_iter_init(variable_list);
-	for(; i.key; ohm_iter_inc(&i)) {
-		synge_t new, *old = i.value;
+char *synge_ctx_number_str(struct synge_ctx *ctx, synge_t num) {
+	int len = synge_ctx_format_number(ctx, num, ctx->number_str_container, ctx->number_str_size);
 
-		mpfr_init2(new, SYNGE_PRECISION);
-		mpfr_set(new, *old, SYNGE_ROUND);
+	/* the container is reused, and only grown when a number doesn't fit */
+	if(len >= ctx->number_str_size) {
+		ctx->number_str_size = len + 1;
+		ctx->number_str_container = realloc(ctx->number_str_container, ctx->number_str_size);
+		synge_ctx_format_number(ctx, num, ctx->number_str_container, ctx->number_str_size);
+	}
+
+	return ctx->number_str_container;
+} /* synge_ctx_number_str() */
 
-		ohm_insert(backup_var, i.key, i.keylen, new, sizeof(synge_t));
+char *synge_ctx_error_msg(struct synge_ctx *ctx, struct synge_err error) {
+	char *msg = get_error_text(error);
+	int len = format_error(ctx, error, msg, ctx->error_msg_container, ctx->error_msg_size);
+
+	/* the container is reused, and only grown when a message doesn't fit */
+	if(len >= ctx->error_msg_size) {
+		ctx->error_msg_size = len + 1;
+		ctx->error_msg_container = realloc(ctx->error_msg_container, ctx->error_msg_size);
+		format_error(ctx, error, msg, ctx->error_msg_container, ctx->error_msg_size);
 	}
 
+	return ctx->error_msg_container;
+} /* synge_ctx_error_msg() */
+
+char *synge_ctx_error_msg_pos(struct synge_ctx *ctx, int code, int pos) {
+	return synge_ctx_error_msg(ctx, to_error_code(code, pos));
+} /* synge_ctx_error_msg_pos() */
+
+struct synge_err synge_internal_compute_string(struct synge_ctx *ctx, char *string, synge_t *result, char *caller, int position, bool discard) {
+	assert(ctx != NULL, "synge context must be initialised");
+
+	/* reset traceback */
+	if(!strcmp(caller, SYNGE_MAIN))
+		trace_truncate(ctx, 0);
+
 	/* intiialise result to zero */
 	mpfr_set_si(*result, 0, SYNGE_ROUND);
 
-	/* We have delved too greedily and too deeply.
-	 * We have awoken a creature in the darkness of recursion.
-	 * A creature of shadow, flame and segmentation faults.
-	 * YOU SHALL NOT PASS! */
+	/* the timeout applies to each evaluation separately */
+	watch_start(ctx);
 
-	static int depth = -1;
-	if(++depth >= SYNGE_MAX_DEPTH) {
-		ohm_free(backup_func);
+	struct synge_err ecode = synge_eval_string(ctx, string, result, caller, position, discard);
 
-		struct ohm_iter ii = ohm_iter_init(backup_var);
-		for(; ii.key; ohm_iter_inc(&ii)) {
-			synge_t *val = ii.value;
-			mpfr_clear(*val);
-		}
+	/* readers on other threads see the words as they are between evaluations */
+	publish_words(ctx);
+	return ecode;
+} /* synge_internal_compute_string() */
 
-		ohm_free(backup_var);
+/* public "exported" interface for above function */
+struct synge_err synge_ctx_compute_string(struct synge_ctx *ctx, char *expression, synge_t *result) {
+	return synge_internal_compute_string(ctx, expression, result, SYNGE_MAIN, 0, false);
+} /* synge_ctx_compute_string() */
 
-		cheeky("YOU SHALL NOT PASS!\n");
-		return to_error_code(TOO_DEEP, -1);
-	}
+struct synge_err synge_ctx_compute_budget(struct synge_ctx *ctx, char *expression, synge_t *result, struct synge_budget *limit, struct synge_budget *used) {
+	assert(ctx != NULL, "synge context must be initialised");
 
-	/* reset traceback */
-	if(!strcmp(caller, SYNGE_MAIN)) {
-		link_free(traceback_list);
-		traceback_list = link_init();
-		depth = -1;
-	}
+	/* the budget only applies to this evaluation */
+	ctx->watch.limit = limit ? *limit : (struct synge_budget) {0, 0, 0};
+	struct synge_err ecode = synge_internal_compute_string(ctx, expression, result, SYNGE_MAIN, 0, false);
+	ctx->watch.limit = (struct synge_budget) {0, 0, 0};
 
-	/* get traceback format from caller type */
-	char *format = NULL;
-	switch(synge_call_type(caller)) {
-		case MODULE:
-			format = SYNGE_TRACEBACK_MODULE;
-			break;
-		case CONDITIONAL:
-			format = SYNGE_TRACEBACK_CONDITIONAL;
-			break;
-		case FUNCTION:
-		default:
-			format = SYNGE_TRACEBACK_FUNCTION;
-			break;
+	if(used)
+		*used = ctx->watch.used;
+
+	return ecode;
+} /* synge_ctx_compute_budget() */
+
+struct synge_settings synge_ctx_get_settings(struct synge_ctx *ctx) {
+	return ctx->settings;
+} /* synge_ctx_get_settings() */
+
+void synge_ctx_set_settings(struct synge_ctx *ctx, struct synge_settings new_settings) {
+	ctx->settings = new_settings;
+
+	/* sanitise precision */
+	if(new_settings.precision > SYNGE_MAX_PRECISION)
+		ctx->settings.precision = SYNGE_MAX_PRECISION;
+
+	/* sanitise depth */
+	if(new_settings.depth < 0)
+		ctx->settings.depth = 0;
+
+	if(new_settings.tails < 0)
+		ctx->settings.tails = 0;
+
+	/* sanitise timeout */
+	if(new_settings.timeout < 0)
+		ctx->settings.timeout = 0;
+} /* synge_ctx_set_settings() */
+
+struct ohm_t *synge_ctx_get_variable_list(struct synge_ctx *ctx) {
+	return ctx->variable_list;
+} /* synge_ctx_get_variable_list() */
+
+struct ohm_t *synge_ctx_get_expression_list(struct synge_ctx *ctx) {
+	return ctx->expression_list;
+} /* synge_ctx_get_expression_list() */
+
+void synge_ctx_seed(struct synge_ctx *ctx, unsigned int seed) {
+	gmp_randseed_ui(ctx->random.state, seed);
+	ctx->random.stream = false;
+} /* synge_ctx_seed() */
+
+void synge_ctx_seed_stream(struct synge_ctx *ctx, unsigned long seed, unsigned long stream) {
+	ctx->random.stream = true;
+	ctx->random.key = stream_key(seed, stream);
+	ctx->random.counter = 0;
+} /* synge_ctx_seed_stream() */
+
+void synge_ctx_set_cancel(struct synge_ctx *ctx, struct synge_cancel *token) {
+	ctx->watch.cancel = token;
+} /* synge_ctx_set_cancel() */
+
+struct synge_ctx *synge_ctx_new(void) {
+	struct synge_ctx *ctx = malloc(sizeof(struct synge_ctx));
+
+	ctx->variable_list = ohm_init(SYNGE_HM_SIZE, NULL);
+	ctx->expression_list = ohm_init(SYNGE_HM_SIZE, NULL);
+
+	mpfr_init2(ctx->prev_answer, SYNGE_PRECISION);
+	mpfr_set_si(ctx->prev_answer, 0, SYNGE_ROUND);
+
+	ohm_insert(ctx->expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1, "", 1);
+
+	ctx->base = NULL;
+	ctx->hidden_list = ohm_init(SYNGE_HM_SIZE, NULL);
+
+	ctx->number_str_container = NULL;
+	ctx->number_str_size = 0;
+
+	ctx->error_msg_container = NULL;
+	ctx->error_msg_size = 0;
+	ctx->traceback_list = (struct synge_trace) {NULL, 0, 0};
+	ctx->settings = default_settings;
+
+	gmp_randinit_default(ctx->random.state);
+	ctx->random.stream = false;
+
+	ctx->watch.cancel = NULL;
+	ctx->watch.deadline = 0;
+	ctx->watch.code = SUCCESS;
+	ctx->watch.limit = ctx->watch.used = (struct synge_budget) {0, 0, 0};
+
+	ctx->publish.enabled = false;
+	ctx->publish.version = 0;
+	ctx->publish.latest = NULL;
+	ctx->publish.readers = 0;
+	ctx->publish.retired = NULL;
+
+	ctx->scratch = (struct synge_scratch) {NULL, NULL, 0};
+	return ctx;
+} /* synge_ctx_new() */
+
+struct synge_ctx *synge_ctx_dup(struct synge_ctx *old) {
+	struct synge_ctx *ctx = malloc(sizeof(struct synge_ctx));
+
+	ctx->variable_list = ohm_dup(old->variable_list);
+	ctx->expression_list = ohm_dup(old->expression_list);
+
+	/* the copied values still share their limbs with the originals, so give them their own */
+	struct ohm_iter i = ohm_iter_init(ctx->variable_list);
+	for(; i.key != NULL; ohm_iter_inc(&i)) {
+		synge_t *value = ohm_search(old->variable_list, i.key, i.keylen);
+		mpfr_init2(i.value, SYNGE_PRECISION);
+		mpfr_set(i.value, *value, SYNGE_ROUND);
 	}
 
-	/* add level to traceback */
-	char *to_add = malloc(lenprintf(format, caller, position));
-	sprintf(to_add, format, caller, position);
+	mpfr_init2(ctx->prev_answer, SYNGE_PRECISION);
+	mpfr_set(ctx->prev_answer, old->prev_answer, SYNGE_ROUND);
 
-	link_append(traceback_list, to_add, strlen(to_add) + 1);
-	free(to_add);
+	/* the base layer is shared, not copied */
+	ctx->base = old->base;
+	ctx->hidden_list = ohm_dup(old->hidden_list);
 
-	debug("depth %d with caller %s\n", depth, caller);
-	debug("expression '%s'\n", string);
+	ctx->number_str_container = NULL;
+	ctx->number_str_size = 0;
 
-	/* initialise all local variables */
-	struct stack *rpn_stack = malloc(sizeof(struct stack)), *infix_stack = malloc(sizeof(struct stack));
-	init_stack(rpn_stack);
-	init_stack(infix_stack);
-	struct synge_err ecode = to_error_code(SUCCESS, -1);
+	ctx->error_msg_container = NULL;
+	ctx->error_msg_size = 0;
+	ctx->traceback_list = (struct synge_trace) {NULL, 0, 0};
+	ctx->settings = old->settings;
 
-	/* generate infix stack */
-	if(ecode.code == SUCCESS)
-		ecode = synge_lex_string(string, &infix_stack);
+	gmp_randinit_set(ctx->random.state, old->random.state);
+	ctx->random.stream = old->random.stream;
+	ctx->random.key = old->random.key;
+	ctx->random.counter = old->random.counter;
 
-	/* convert to postfix (or RPN) stack */
-	if(ecode.code == SUCCESS)
-		ecode = synge_infix_parse(&infix_stack, &rpn_stack);
+	/* the copy watches the same cancellation token */
+	ctx->watch = old->watch;
 
-	/* evaluate postfix (or RPN) stack */
-	if(ecode.code == SUCCESS)
-		ecode = synge_eval_rpnstack(&rpn_stack, result);
+	/* but it doesn't publish its words until asked to */
+	ctx->publish.enabled = false;
+	ctx->publish.version = 0;
+	ctx->publish.latest = NULL;
+	ctx->publish.readers = 0;
+	ctx->publish.retired = NULL;
 
-	/* measure depth, not length */
-	depth--;
+	ctx->scratch = (struct synge_scratch) {NULL, NULL, 0};
+	return ctx;
+} /* synge_ctx_dup() */
 
-	/* fix up negative zeros */
-	if(iszero(*result))
-		mpfr_abs(*result, *result, SYNGE_ROUND);
+static void drain_retired(struct synge_ctx *);
 
-	/* is it a nan? */
-	if(mpfr_nan_p(*result))
-		ecode = to_error_code(UNDEFINED, -1);
+void synge_ctx_free(struct synge_ctx *ctx) {
+	/* mpfr_free variables */
+	struct ohm_iter i = ohm_iter_init(ctx->variable_list);
+	for(; i.key != NULL; ohm_iter_inc(&i))
+		mpfr_clear(i.value);
+
+	ohm_free(ctx->variable_list);
+	ohm_free(ctx->expression_list);
+	ohm_free(ctx->hidden_list);
+
+	trace_truncate(ctx, 0);
+	free(ctx->traceback_list.frames);
+
+	free(ctx->number_str_container);
+	free(ctx->error_msg_container);
+
+	int j;
+	for(j = 0; j < ctx->scratch.size; j++)
+		mpfr_clear(ctx->scratch.values[j]);
+
+	free(ctx->scratch.values);
+	free(ctx->scratch.args);
+
+	mpfr_clears(ctx->prev_answer, NULL);
+	gmp_randclear(ctx->random.state);
+
+	/* readers may still hold the latest snapshot, but nothing can be taking one by now so every retired one can go */
+	synge_ctx_publish(ctx, false);
+	drain_retired(ctx);
+	free(ctx);
+} /* synge_ctx_free() */
+
+/* copy a variable into a base layer, unless it's already there */
+static void base_add_variable(struct synge_base *base, void *key, size_t keylen, synge_t *value) {
+	if(ohm_search(base->variable_list, key, keylen) || ohm_search(base->expression_list, key, keylen))
+		return;
+
+	synge_t copy;
+	mpfr_init2(copy, SYNGE_PRECISION);
+	mpfr_set(copy, *value, SYNGE_ROUND);
+	ohm_insert(base->variable_list, key, keylen, copy, sizeof(synge_t));
+} /* base_add_variable() */
+
+/* copy a function into a base layer, unless it's already there */
+static void base_add_function(struct synge_base *base, void *key, size_t keylen, char *exp) {
+	if(ohm_search(base->variable_list, key, keylen) || ohm_search(base->expression_list, key, keylen))
+		return;
+
+	ohm_insert(base->expression_list, key, keylen, exp, strlen(exp) + 1);
+} /* base_add_function() */
+
+/* copy the context's own words into a base layer */
+static void base_add_overlay(struct synge_base *base, struct synge_ctx *ctx) {
+	struct ohm_iter i = ohm_iter_init(ctx->variable_list);
+	for(; i.key != NULL; ohm_iter_inc(&i))
+		base_add_variable(base, i.key, i.keylen, i.value);
 
-	/* if some error occured, revert variables and functions back to previous good state */
-	if(!synge_is_success_code(ecode.code) && !synge_is_ignore_code(ecode.code)) {
-		/* mpfr_clear variable list */
-		struct ohm_iter i = ohm_iter_init(variable_list);
+	/* '_' belongs to each context */
+	i = ohm_iter_init(ctx->expression_list);
+	for(; i.key != NULL; ohm_iter_inc(&i))
+		if(strcmp(i.key, SYNGE_PREV_EXPRESSION))
+			base_add_function(base, i.key, i.keylen, i.value);
+} /* base_add_overlay() */
+
+static struct synge_base *base_alloc(void) {
+	struct synge_base *base = malloc(sizeof(struct synge_base));
+
+	base->variable_list = ohm_init(SYNGE_HM_SIZE, NULL);
+	base->expression_list = ohm_init(SYNGE_HM_SIZE, NULL);
+	return base;
+} /* base_alloc() */
+
+struct synge_base *synge_base_new(struct synge_ctx *ctx) {
+	struct synge_base *base = base_alloc();
+
+	/* the context's own words come first, as they shadow its base layer's */
+	base_add_overlay(base, ctx);
+
+	if(ctx->base) {
+		struct ohm_iter i = ohm_iter_init(ctx->base->variable_list);
 		for(; i.key != NULL; ohm_iter_inc(&i))
-			mpfr_clear(i.value);
+			if(!ohm_search(ctx->hidden_list, i.key, i.keylen))
+				base_add_variable(base, i.key, i.keylen, i.value);
 
-		ohm_cpy(variable_list, backup_var);
-		ohm_cpy(expression_list, backup_func);
+		i = ohm_iter_init(ctx->base->expression_list);
+		for(; i.key != NULL; ohm_iter_inc(&i))
+			if(!ohm_search(ctx->hidden_list, i.key, i.keylen))
+				base_add_function(base, i.key, i.keylen, i.value);
 	}
 
-	/* no error -- clear backup variable list */
-	else {
-		struct ohm_iter j = ohm_iter_init(backup_var);
-		for(; j.key; ohm_iter_inc(&j))
-			mpfr_clear(j.value);
-	}
+	return base;
+} /* synge_base_new() */
 
-	/* make sure user hasn't done something like set '_' to a variable or deleted it */
-	ohm_remove(variable_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1);
-	if(!ohm_search(expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1))
-			ohm_insert(expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1, "", 1);
+void synge_base_free(struct synge_base *base) {
+	struct ohm_iter i = ohm_iter_init(base->variable_list);
+	for(; i.key != NULL; ohm_iter_inc(&i))
+		mpfr_clear(i.value);
+
+	ohm_free(base->variable_list);
+	ohm_free(base->expression_list);
+	free(base);
+} /* synge_base_free() */
+
+void synge_ctx_set_base(struct synge_ctx *ctx, struct synge_base *base) {
+	ctx->base = base;
 
-	/* if everything went well, set the answer variable (and remove current depth from traceback) */
-	if(synge_is_success_code(ecode.code)) {
-		mpfr_set(prev_answer, *result, SYNGE_ROUND);
-		link_pend(traceback_list);
+	/* deleted words only hide words in the old base */
+	ohm_free(ctx->hidden_list);
+	ctx->hidden_list = ohm_init(SYNGE_HM_SIZE, NULL);
 
-		/* if the expression doesn't contain '_', set '_' to the expression*/
-		char *stripped = trim_spaces(string);
+	ctx->publish.version++;
+	publish_words(ctx);
+} /* synge_ctx_set_base() */
 
-		if(!contains_word(stripped, SYNGE_PREV_EXPRESSION, SYNGE_WORD_CHARS))
-			ohm_insert(expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1, stripped, strlen(stripped) + 1);
+/* a published version of a context's words, which lives until its last reader (or the context) lets go of it. only
+ * the context's own words are copied -- its base layer can't change, so the snapshot just refers to it. */
+struct synge_snapshot {
+	struct synge_base *words; /* copy of the context's own words */
+	struct synge_base *base; /* the context's base layer (or NULL) */
+	struct ohm_t *hidden_list; /* base words the context had deleted */
 
-		free(stripped);
+	unsigned long version;
+
+	int refs; /* only ever changed atomically */
+	struct synge_snapshot *next; /* next retired snapshot */
+};
+
+void synge_snapshot_release(struct synge_snapshot *snapshot) {
+	if(__atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_SEQ_CST))
+		return;
+
+	synge_base_free(snapshot->words);
+	ohm_free(snapshot->hidden_list);
+	free(snapshot);
+} /* synge_snapshot_release() */
+
+/* let go of the context's references to every retired snapshot */
+static void drain_retired(struct synge_ctx *ctx) {
+	while(ctx->publish.retired) {
+		struct synge_snapshot *snapshot = ctx->publish.retired;
+		ctx->publish.retired = snapshot->next;
+		synge_snapshot_release(snapshot);
 	}
+} /* drain_retired() */
 
-	/* free memory */
-	ohm_free(backup_var);
-	ohm_free(backup_func);
+/* replace the context's latest snapshot. a reader could still be part of the way through taking the old one, so it is
+ * retired rather than released -- retired snapshots are let go of the next time no reader is taking a snapshot. */
+static void swap_snapshot(struct synge_ctx *ctx, struct synge_snapshot *snapshot) {
+	struct synge_snapshot *old = __atomic_exchange_n(&ctx->publish.latest, snapshot, __ATOMIC_SEQ_CST);
 
-	free_stackm(&infix_stack, &rpn_stack);
-	return ecode;
-} /* synge_internal_compute_string() */
+	if(old) {
+		old->next = ctx->publish.retired;
+		ctx->publish.retired = old;
+	}
+
+	/* any reader which starts after this point can only see the new snapshot */
+	if(!__atomic_load_n(&ctx->publish.readers, __ATOMIC_SEQ_CST))
+		drain_retired(ctx);
+} /* swap_snapshot() */
+
+/* publish a new snapshot if the context's words have changed since the last one (only called between evaluations) */
+void publish_words(struct synge_ctx *ctx) {
+	struct synge_publish *publish = &ctx->publish;
+
+	/* the latest snapshot is only ever replaced by the context's own thread, so it can be checked directly */
+	if(!publish->enabled || (publish->latest && publish->latest->version == publish->version))
+		return;
+
+	struct synge_snapshot *snapshot = malloc(sizeof(struct synge_snapshot));
+
+	snapshot->words = base_alloc();
+	base_add_overlay(snapshot->words, ctx);
+
+	snapshot->base = ctx->base;
+	snapshot->hidden_list = ohm_dup(ctx->hidden_list);
+	snapshot->version = publish->version;
+
+	snapshot->refs = 1; /* the context's reference */
+	snapshot->next = NULL;
+
+	swap_snapshot(ctx, snapshot);
+} /* publish_words() */
+
+void synge_ctx_publish(struct synge_ctx *ctx, bool enabled) {
+	ctx->publish.enabled = enabled;
+
+	if(enabled)
+		publish_words(ctx);
+	else
+		swap_snapshot(ctx, NULL);
+} /* synge_ctx_publish() */
+
+struct synge_snapshot *synge_ctx_get_snapshot(struct synge_ctx *ctx) {
+	/* the context won't let go of a snapshot it has replaced while any reader is in here */
+	__atomic_add_fetch(&ctx->publish.readers, 1, __ATOMIC_SEQ_CST);
+
+	struct synge_snapshot *snapshot = __atomic_load_n(&ctx->publish.latest, __ATOMIC_SEQ_CST);
+	if(snapshot)
+		__atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_SEQ_CST);
+
+	__atomic_sub_fetch(&ctx->publish.readers, 1, __ATOMIC_SEQ_CST);
+	return snapshot;
+} /* synge_ctx_get_snapshot() */
+
+unsigned long synge_snapshot_version(struct synge_snapshot *snapshot) {
+	return snapshot->version;
+} /* synge_snapshot_version() */
+
+struct ohm_t *synge_snapshot_variable_list(struct synge_snapshot *snapshot) {
+	return snapshot->words->variable_list;
+} /* synge_snapshot_variable_list() */
+
+struct ohm_t *synge_snapshot_expression_list(struct synge_snapshot *snapshot) {
+	return snapshot->words->expression_list;
+} /* synge_snapshot_expression_list() */
+
+/* the snapshot's own words (and deleted base words) shadow its base layer, the same way as in_overlay() */
+static struct synge_base *snapshot_layer(struct synge_snapshot *snapshot, char *s, size_t len) {
+	struct synge_base *words = snapshot->words;
+
+	if(!snapshot->base || ohm_search(words->variable_list, s, len) ||
+			ohm_search(words->expression_list, s, len) || ohm_search(snapshot->hidden_list, s, len))
+		return words;
+	return snapshot->base;
+} /* snapshot_layer() */
+
+synge_t *synge_snapshot_get_variable(struct synge_snapshot *snapshot, char *name) {
+	size_t len = strlen(name) + 1;
+	return ohm_search(snapshot_layer(snapshot, name, len)->variable_list, name, len);
+} /* synge_snapshot_get_variable() */
+
+char *synge_snapshot_get_expression(struct synge_snapshot *snapshot, char *name) {
+	size_t len = strlen(name) + 1;
+	return ohm_search(snapshot_layer(snapshot, name, len)->expression_list, name, len);
+} /* synge_snapshot_get_expression() */
+
+void synge_ctx_reset_traceback(struct synge_ctx *ctx) {
+	/* clear previous traceback and reset it to base notation */
+	trace_truncate(ctx, 0);
+	trace_push(ctx, SYNGE_MAIN, 0);
+} /* synge_ctx_reset_traceback() */
+
+/* the global interface is a thin wrapper around the default context */
+
+int synge_get_precision(synge_t num) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_get_precision(default_ctx, num);
+} /* synge_get_precision() */
+
+int synge_format_number(synge_t num, char *buf, size_t size) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_format_number(default_ctx, num, buf, size);
+} /* synge_format_number() */
+
+char *synge_number_str(synge_t num) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_number_str(default_ctx, num);
+} /* synge_number_str() */
+
+char *synge_error_msg(struct synge_err error) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_error_msg(default_ctx, error);
+} /* synge_error_msg() */
+
+int synge_format_error(struct synge_err error, char *buf, size_t size) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_format_error(default_ctx, error, buf, size);
+} /* synge_format_error() */
+
+char *synge_error_msg_pos(int code, int pos) {
+	return synge_error_msg(to_error_code(code, pos));
+} /* synge_error_msg_pos() */
 
-/* public "exported" interface for above function */
 struct synge_err synge_compute_string(char *expression, synge_t *result) {
-	return synge_internal_compute_string(expression, result, SYNGE_MAIN, 0);
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_compute_string(default_ctx, expression, result);
 } /* synge_compute_string() */
 
-struct synge_settings synge_get_settings(void) {
-	return active_settings;
-} /* get_synge_settings() */
+struct synge_err synge_compute_budget(char *expression, synge_t *result, struct synge_budget *limit, struct synge_budget *used) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_compute_budget(default_ctx, expression, result, limit, used);
+} /* synge_compute_budget() */
 
-void synge_set_settings(struct synge_settings new_settings) {
-	active_settings = new_settings;
+void synge_publish(bool enabled) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_publish(default_ctx, enabled);
+} /* synge_publish() */
 
-	/* sanitise precision */
-	if(new_settings.precision > SYNGE_MAX_PRECISION)
-		active_settings.precision = SYNGE_MAX_PRECISION;
-} /* set_synge_settings() */
+struct synge_snapshot *synge_get_snapshot(void) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_get_snapshot(default_ctx);
+} /* synge_get_snapshot() */
 
-struct synge_func *synge_get_function_list(void) {
-	return func_list;
-} /* get_synge_function_list() */
+struct synge_settings synge_get_settings(void) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_get_settings(default_ctx);
+} /* synge_get_settings() */
+
+void synge_set_settings(struct synge_settings new_settings) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_set_settings(default_ctx, new_settings);
+} /* synge_set_settings() */
 
 struct ohm_t *synge_get_variable_list(void) {
-	return variable_list;
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_get_variable_list(default_ctx);
 } /* synge_get_variable_list() */
 
 struct ohm_t *synge_get_expression_list(void) {
-	return expression_list;
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_get_expression_list(default_ctx);
 } /* synge_get_expression_list() */
 
+struct synge_func *synge_get_function_list(void) {
+	return func_list;
+} /* get_synge_function_list() */
+
 static int size_list(struct synge_const *list) {
 	int i, len = 0;
 	for(i = 0; list[i].name != NULL; i++)
@@ -489,64 +1140,37 @@ struct synge_word *synge_get_constant_list(void) {
 } /* synge_get_constant_list() */
 
 void synge_seed(unsigned int seed) {
-	assert(synge_started == true, "synge must be initialised");
-	gmp_randseed_ui(synge_state, seed);
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_seed(default_ctx, seed);
 } /* synge_seed() */
 
-void synge_start(void) {
-	assert(synge_started == false, "synge mustn't be initialised");
-
-	variable_list = ohm_init(SYNGE_HM_SIZE, NULL);
-	expression_list = ohm_init(SYNGE_HM_SIZE, NULL);
-	traceback_list = link_init();
+void synge_seed_stream(unsigned long seed, unsigned long stream) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_seed_stream(default_ctx, seed, stream);
+} /* synge_seed_stream() */
 
-	mpfr_init2(prev_answer, SYNGE_PRECISION);
-	mpfr_set_si(prev_answer, 0, SYNGE_ROUND);
+void synge_set_cancel(struct synge_cancel *token) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_set_cancel(default_ctx, token);
+} /* synge_set_cancel() */
 
-	ohm_insert(expression_list, SYNGE_PREV_EXPRESSION, strlen(SYNGE_PREV_EXPRESSION) + 1, "", 1);
-
-	gmp_randinit_default(synge_state);
-	synge_started = true;
-} /* synge_end() */
+void synge_start(void) {
+	assert(default_ctx == NULL, "synge mustn't be initialised");
+	default_ctx = synge_ctx_new();
+} /* synge_start() */
 
 void synge_end(void) {
-	assert(synge_started == true, "synge must be initialised");
-
-	/* mpfr_free variables */
-	struct ohm_iter i = ohm_iter_init(variable_list);
-	for(; i.key != NULL; ohm_iter_inc(&i))
-		mpfr_clear(i.value);
-
-	ohm_free(variable_list);
-	ohm_free(expression_list);
+	assert(default_ctx != NULL, "synge must be initialised");
 
-	link_free(traceback_list);
-	free(error_msg_container);
+	synge_ctx_free(default_ctx);
+	default_ctx = NULL;
 
-	mpfr_clears(prev_answer, NULL);
 	mpfr_free_cache();
-
-	gmp_randclear(synge_state);
-	synge_started = false;
 } /* synge_end() */
 
 void synge_reset_traceback(void) {
-	assert(synge_started == true, "synge must be initialised");
-
-	/* free previous traceback and allocate new one */
-	if(traceback_list)
-		link_free(traceback_list);
-
-	traceback_list = link_init();
-
-	/* reset traceback to base notation */
-	int len = lenprintf(SYNGE_TRACEBACK_MODULE, SYNGE_MAIN);
-	char *tmp = malloc(len);
-	sprintf(tmp, SYNGE_TRACEBACK_MODULE, SYNGE_MAIN);
-
-	link_append(traceback_list, tmp, len);
-
-	free(tmp);
+	assert(default_ctx != NULL, "synge must be initialised");
+	synge_ctx_reset_traceback(default_ctx);
 } /* synge_reset_traceback() */
 
 struct synge_ver synge_get_version(void) {
@@ -0,0 +1,569 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "synge.h"
+#include "global.h"
+#include "common.h"
+#include "stack.h"
+
+/* rows evaluated by each pass of an instruction (small enough for the stack to stay in cache) */
+#define VECTOR_BLOCK 256
+
+/* how deeply user functions can be inlined (recursive functions can't be compiled) */
+#define VECTOR_MAX_INLINE 64
+
+/* most instructions a compiled expression can have (inlining can make expressions grow very quickly) */
+#define VECTOR_MAX_LENGTH (1 << 20)
+
+/* state while compiling an expression */
+struct vec_compiler {
+	struct synge_ctx *ctx;
+	struct synge_vector *vector;
+	char **variables;
+	int depth; /* current stack depth */
+};
+
+static double vec_bool(double x) {
+	return x != 0;
+} /* vec_bool() */
+
+static double vec_fact(double x) {
+	return copysign(tgamma(floor(fabs(x)) + 1), x);
+} /* vec_fact() */
+
+static double vec_sum(double x) {
+	x = floor(x);
+	return x * (x + 1) / 2;
+} /* vec_sum() */
+
+static double vec_deg2rad(double x) {
+	return x * M_PI / 180;
+} /* vec_deg2rad() */
+
+static double vec_deg2grad(double x) {
+	return x * 200 / 180;
+} /* vec_deg2grad() */
+
+static double vec_rad2deg(double x) {
+	return x * 180 / M_PI;
+} /* vec_rad2deg() */
+
+static double vec_rad2grad(double x) {
+	return x * 200 / M_PI;
+} /* vec_rad2grad() */
+
+static double vec_grad2deg(double x) {
+	return x * 180 / 200;
+} /* vec_grad2deg() */
+
+static double vec_grad2rad(double x) {
+	return x * M_PI / 200;
+} /* vec_grad2rad() */
+
+/* double precision versions of the builtin functions (those using random numbers can't be compiled) */
+static struct vec_func vec_func_list[] = {
+	{"abs",			fabs},
+	{"sqrt",		sqrt},
+	{"cbrt",		cbrt},
+
+	{"round",		round},
+	{"ceil",		ceil},
+	{"floor",		floor},
+
+	{"log",			log2},
+	{"ln",			log},
+	{"log10",		log10},
+
+	{"fact",		vec_fact},
+	{"sum",			vec_sum},
+	{"bool",		vec_bool},
+
+	{"deg2rad",		vec_deg2rad},
+	{"deg2grad",	vec_deg2grad},
+	{"rad2deg",		vec_rad2deg},
+	{"rad2grad",	vec_rad2grad},
+	{"grad2deg",	vec_grad2deg},
+	{"grad2rad",	vec_grad2rad},
+
+	{"sinh",		sinh},
+	{"cosh",		cosh},
+	{"tanh",		tanh},
+	{"asinh",		asinh},
+	{"acosh",		acosh},
+	{"atanh",		atanh},
+
+	{"sin",			sin},
+	{"cos",			cos},
+	{"tan",			tan},
+	{"asin",		asin},
+	{"acos",		acos},
+	{"atan",		atan},
+	{NULL,			NULL}
+};
+
+static struct vec_func *get_vec_func(char *name) {
+	int i;
+	for(i = 0; vec_func_list[i].name; i++)
+		if(!strcmp(vec_func_list[i].name, name))
+			return &vec_func_list[i];
+
+	return NULL;
+} /* get_vec_func() */
+
+/* append an instruction, keeping track of how deep the stack gets */
+static void emit(struct vec_compiler *c, int kind, int op, double value, struct vec_func *func) {
+	struct synge_vector *vector = c->vector;
+
+	if(vector->length >= vector->size) {
+		vector->size = vector->size ? vector->size * 2 : 16;
+		vector->code = realloc(vector->code, vector->size * sizeof(struct vec_instruction));
+	}
+
+	vector->code[vector->length++] = (struct vec_instruction) {kind, op, value, func};
+
+	switch(kind) {
+		case vec_value:
+		case vec_column:
+			c->depth++;
+			break;
+		case vec_binary:
+			c->depth--;
+			break;
+		case vec_select:
+			c->depth -= 2;
+			break;
+	}
+
+	if(c->depth > vector->depth)
+		vector->depth = c->depth;
+} /* emit() */
+
+/* push a constant, keeping its full precision value */
+static void emit_value(struct vec_compiler *c, synge_t value) {
+	struct synge_vector *vector = c->vector;
+
+	vector->constants = realloc(vector->constants, (vector->nconstants + 1) * sizeof(synge_t));
+	mpfr_init2(vector->constants[vector->nconstants], SYNGE_PRECISION);
+	mpfr_set(vector->constants[vector->nconstants], value, SYNGE_ROUND);
+
+	emit(c, vec_value, vector->nconstants++, mpfr_get_d(value, SYNGE_ROUND), NULL);
+} /* emit_value() */
+
+static struct synge_err compile_string(struct vec_compiler *, char *, int, int);
+
+/* compile a word -- columns are read per row, variables are fixed when compiling and functions are inlined */
+static struct synge_err compile_word(struct vec_compiler *c, char *word, int inlined, int pos) {
+	int i;
+	for(i = 0; i < c->vector->columns; i++) {
+		if(!strcmp(c->variables[i], word)) {
+			emit(c, vec_column, i, 0, NULL);
+			return to_error_code(SUCCESS, -1);
+		}
+	}
+
+	synge_t *value = get_variable(c->ctx, word);
+	char *exp = get_function(c->ctx, word);
+
+	if(value)
+		emit_value(c, *value);
+	else if(exp)
+		return compile_string(c, exp, inlined + 1, pos);
+	else
+		return to_error_code(UNKNOWN_TOKEN, pos);
+
+	return to_error_code(SUCCESS, -1);
+} /* compile_word() */
+
+static struct synge_err compile_rpn(struct vec_compiler *c, struct stack *rpn, int inlined, int outer) {
+	/* conditional bodies waiting for their else operator */
+	char **bodies = malloc(stack_size(rpn) * sizeof(char *));
+	int nbodies = 0;
+
+	struct synge_err ecode = to_error_code(SUCCESS, -1);
+
+	int i;
+	for(i = 0; i < stack_size(rpn) && synge_is_success_code(ecode.code); i++) {
+		struct stack_cont *token = &rpn->content[i];
+
+		/* errors inside inlined functions are reported at the call */
+		int pos = outer >= 0 ? outer : token->position;
+
+		if(c->vector->length > VECTOR_MAX_LENGTH) {
+			ecode = to_error_code(TOO_DEEP, pos);
+			break;
+		}
+
+		switch(token->tp) {
+			case number:
+			case constant:
+				{
+					synge_t value;
+					mpfr_init2(value, SYNGE_PRECISION);
+					get_numstack(token, value);
+
+					emit_value(c, value);
+					mpfr_clear(value);
+				}
+				break;
+			case userword:
+				ecode = compile_word(c, token->val.str, inlined, pos);
+				break;
+			case expression:
+				bodies[nbodies++] = token->val.str;
+				break;
+			case func:
+				{
+					struct vec_func *f = get_vec_func(token->val.func->name);
+
+					if(c->depth < 1)
+						ecode = to_error_code(FUNCTION_WRONG_ARGC, pos);
+					else if(!f || token->val.func->args != 1)
+						ecode = to_error_code(UNKNOWN_TOKEN, pos);
+					else
+						emit(c, vec_func, token->val.func->flags & (func_angle_in | func_angle_out), 0, f);
+				}
+				break;
+			case signop:
+			case preop:
+				if(c->depth < 1)
+					ecode = to_error_code(OPERATOR_WRONG_ARGC, pos);
+				else if(token->val.op == op_add)
+					emit(c, vec_unary, vec_pos, 0, NULL);
+				else if(token->val.op == op_subtract)
+					emit(c, vec_unary, vec_neg, 0, NULL);
+				else
+					emit(c, vec_unary, token->val.op, 0, NULL);
+				break;
+			case bitop:
+			case compop:
+			case addop:
+			case multop:
+			case expop:
+				if(c->depth < 2)
+					ecode = to_error_code(OPERATOR_WRONG_ARGC, pos);
+				else
+					emit(c, vec_binary, token->val.op, 0, NULL);
+				break;
+			case elseop:
+				{
+					if(i + 1 >= stack_size(rpn) || rpn->content[i + 1].tp != ifop) {
+						ecode = to_error_code(MISSING_IF, pos);
+						break;
+					}
+
+					if(c->depth < 1 || nbodies < 2) {
+						ecode = to_error_code(OPERATOR_WRONG_ARGC, pos);
+						break;
+					}
+
+					/* both branches are computed for every row, and the condition picks between them */
+					char *elsebody = bodies[--nbodies], *ifbody = bodies[--nbodies];
+
+					ecode = compile_string(c, ifbody, inlined, pos);
+					if(synge_is_success_code(ecode.code))
+						ecode = compile_string(c, elsebody, inlined, pos);
+					if(synge_is_success_code(ecode.code))
+						emit(c, vec_select, 0, 0, NULL);
+
+					/* skip past the if operator */
+					i++;
+				}
+				break;
+			case ifop:
+				ecode = to_error_code(MISSING_ELSE, pos);
+				break;
+			default:
+				/* words can't be changed (and so on) in a compiled expression */
+				ecode = to_error_code(UNKNOWN_TOKEN, pos);
+				break;
+		}
+	}
+
+	free(bodies);
+	return ecode;
+} /* compile_rpn() */
+
+/* compile an expression, which should leave exactly one more value on the stack */
+static struct synge_err compile_string(struct vec_compiler *c, char *string, int inlined, int outer) {
+	if(inlined > VECTOR_MAX_INLINE)
+		return to_error_code(TOO_DEEP, outer);
+
+	struct stack *infix = malloc(sizeof(struct stack)), *rpn = malloc(sizeof(struct stack));
+	init_stack(infix);
+	init_stack(rpn);
+
+	struct synge_err ecode = synge_lex_string(c->ctx, string, &infix);
+
+	if(synge_is_success_code(ecode.code))
+		ecode = synge_infix_parse(c->ctx, &infix, &rpn);
+
+	free_stackm(&infix);
+
+	int start = c->depth;
+
+	if(synge_is_success_code(ecode.code))
+		ecode = compile_rpn(c, rpn, inlined, outer);
+
+	if(synge_is_success_code(ecode.code) && c->depth != start + 1)
+		ecode = to_error_code(c->depth > start ? TOO_MANY_VALUES : EMPTY_STACK, outer);
+
+	/* reposition errors in inlined expressions */
+	if(!synge_is_success_code(ecode.code) && outer >= 0)
+		ecode = to_error_code(ecode.code, outer);
+
+	free_stackm(&rpn);
+	return ecode;
+} /* compile_string() */
+
+struct synge_vector *synge_ctx_vector_compile(struct synge_ctx *ctx, char *expression, char **variables, int count, struct synge_err *error) {
+	assert(ctx != NULL, "synge context must be initialised");
+
+	struct synge_vector *vector = malloc(sizeof(struct synge_vector));
+
+	vector->code = NULL;
+	vector->length = vector->size = 0;
+	vector->depth = 0;
+	vector->columns = count;
+	vector->constants = NULL;
+	vector->nconstants = 0;
+	vector->mode = ctx->settings.mode;
+
+	switch(ctx->settings.mode) {
+		case degrees:
+			vector->to_rad = M_PI / 180;
+			break;
+		case gradians:
+			vector->to_rad = M_PI / 200;
+			break;
+		case radians:
+		default:
+			vector->to_rad = 1;
+			break;
+	}
+
+	vector->from_rad = 1 / vector->to_rad;
+
+	struct vec_compiler c = {
+		.ctx = ctx,
+		.vector = vector,
+		.variables = variables,
+		.depth = 0
+	};
+
+	trace_truncate(ctx, 0);
+	struct synge_err ecode = compile_string(&c, expression, 0, -1);
+
+	if(error)
+		*error = ecode;
+
+	if(!synge_is_success_code(ecode.code)) {
+		synge_vector_free(vector);
+		return NULL;
+	}
+
+	return vector;
+} /* synge_ctx_vector_compile() */
+
+struct synge_vector *synge_vector_compile(char *expression, char **variables, int count, struct synge_err *error) {
+	assert(default_ctx != NULL, "synge must be initialised");
+	return synge_ctx_vector_compile(default_ctx, expression, variables, count, error);
+} /* synge_vector_compile() */
+
+void synge_vector_free(struct synge_vector *vector) {
+	int i;
+	for(i = 0; i < vector->nconstants; i++)
+		mpfr_clear(vector->constants[i]);
+
+	free(vector->constants);
+	free(vector->code);
+	free(vector);
+} /* synge_vector_free() */
+
+/* the kernels below work on a whole block at a time (with no calls or branches in the simple ones, so they vectorise) */
+
+static void kernel_unary(int op, double *a, int n) {
+	int j;
+	switch(op) {
+		case vec_neg:
+			for(j = 0; j < n; j++)
+				a[j] = -a[j];
+			break;
+		case op_bnot:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] == 0;
+			break;
+		case op_binv:
+			/* ~a => -(a+1) */
+			for(j = 0; j < n; j++)
+				a[j] = -(round(a[j]) + 1);
+			break;
+		default:
+			break;
+	}
+} /* kernel_unary() */
+
+static void kernel_binary(int op, double *a, double *b, int n) {
+	int j;
+	switch(op) {
+		case op_add:
+			for(j = 0; j < n; j++)
+				a[j] += b[j];
+			break;
+		case op_subtract:
+			for(j = 0; j < n; j++)
+				a[j] -= b[j];
+			break;
+		case op_multiply:
+			for(j = 0; j < n; j++)
+				a[j] *= b[j];
+			break;
+		case op_divide:
+			/* rows which divide by zero are undefined */
+			for(j = 0; j < n; j++)
+				a[j] = b[j] == 0 ? NAN : a[j] / b[j];
+			break;
+		case op_int_divide:
+			for(j = 0; j < n; j++)
+				a[j] = b[j] == 0 ? NAN : trunc(a[j] / b[j]);
+			break;
+		case op_modulo:
+			for(j = 0; j < n; j++)
+				a[j] = b[j] == 0 ? NAN : fmod(a[j], b[j]);
+			break;
+		case op_index:
+			for(j = 0; j < n; j++)
+				a[j] = pow(a[j], b[j]);
+			break;
+		case op_gt:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] > b[j];
+			break;
+		case op_gteq:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] >= b[j];
+			break;
+		case op_lt:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] < b[j];
+			break;
+		case op_lteq:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] <= b[j];
+			break;
+		case op_neq:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] != b[j];
+			break;
+		case op_eq:
+			for(j = 0; j < n; j++)
+				a[j] = a[j] == b[j];
+			break;
+		case op_band:
+			for(j = 0; j < n; j++)
+				a[j] = (double) ((int64_t) nearbyint(a[j]) & (int64_t) nearbyint(b[j]));
+			break;
+		case op_bor:
+			for(j = 0; j < n; j++)
+				a[j] = (double) ((int64_t) nearbyint(a[j]) | (int64_t) nearbyint(b[j]));
+			break;
+		case op_bxor:
+			for(j = 0; j < n; j++)
+				a[j] = (double) ((int64_t) nearbyint(a[j]) ^ (int64_t) nearbyint(b[j]));
+			break;
+		case op_bshiftl:
+			/* x << y === x * 2^y */
+			for(j = 0; j < n; j++)
+				a[j] = trunc(ldexp(trunc(a[j]), (int) trunc(b[j])));
+			break;
+		case op_bshiftr:
+			/* x >> y === x / 2^y */
+			for(j = 0; j < n; j++)
+				a[j] = trunc(ldexp(trunc(a[j]), -(int) trunc(b[j])));
+			break;
+		default:
+			break;
+	}
+} /* kernel_binary() */
+
+static void kernel_func(struct synge_vector *vector, struct vec_func *func, int flags, double *a, int n) {
+	/* angles are converted on the way in and out of the function (multiplying by 1 changes nothing) */
+	double in = flags & func_angle_in ? vector->to_rad : 1;
+	double out = flags & func_angle_out ? vector->from_rad : 1;
+
+	int j;
+	for(j = 0; j < n; j++)
+		a[j] = func->get(a[j] * in) * out;
+} /* kernel_func() */
+
+static void kernel_select(double *cond, double *a, double *b, int n) {
+	int j;
+	for(j = 0; j < n; j++)
+		cond[j] = cond[j] != 0 ? a[j] : b[j];
+} /* kernel_select() */
+
+void synge_vector_run(struct synge_vector *vector, double **columns, int rows, double *output) {
+	/* the stack holds a block of rows in each slot */
+	double *stack = malloc(vector->depth * VECTOR_BLOCK * sizeof(double));
+
+	int start;
+	for(start = 0; start < rows; start += VECTOR_BLOCK) {
+		int n = rows - start < VECTOR_BLOCK ? rows - start : VECTOR_BLOCK;
+		double *top = stack - VECTOR_BLOCK; /* the slot at the top of the stack */
+
+		int i, j;
+		for(i = 0; i < vector->length; i++) {
+			struct vec_instruction *in = &vector->code[i];
+
+			switch(in->kind) {
+				case vec_value:
+					top += VECTOR_BLOCK;
+					for(j = 0; j < n; j++)
+						top[j] = in->value;
+					break;
+				case vec_column:
+					top += VECTOR_BLOCK;
+					memcpy(top, columns[in->op] + start, n * sizeof(double));
+					break;
+				case vec_unary:
+					kernel_unary(in->op, top, n);
+					break;
+				case vec_binary:
+					top -= VECTOR_BLOCK;
+					kernel_binary(in->op, top, top + VECTOR_BLOCK, n);
+					break;
+				case vec_func:
+					kernel_func(vector, in->func, in->op, top, n);
+					break;
+				case vec_select:
+					top -= 2 * VECTOR_BLOCK;
+					kernel_select(top, top + VECTOR_BLOCK, top + 2 * VECTOR_BLOCK, n);
+					break;
+			}
+		}
+
+		memcpy(output + start, stack, n * sizeof(double));
+	}
+
+	free(stack);
+} /* synge_vector_run() */
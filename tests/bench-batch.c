@@ -0,0 +1,119 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SYNPOSIS:
+ *        ./tests/bench-batch [expressions] [threads]
+ *
+ * DESCRIPION:
+ *        Time synge_compute_batch() over the given number of expressions (default 20000), with
+ *        every thread count from 1 to the given maximum (default is the number of cores), checking
+ *        that every run gives the same results as the single-threaded run.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <synge.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+static char *templates[] = {
+	"sin(%d)^2 + cos(%d)^2",
+	"sqrt(%d) * cbrt(%d) / ln(%d + 1)",
+	"fact(%d %% 30) // sum(%d)",
+	"(%d > 500) ? atan(%d) : tanh(%d / 1000)",
+	"(x = %d) * x - %d^2 + f",
+	NULL
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* now() */
+
+int main(int argc, char **argv) {
+	int count = argc > 1 ? atoi(argv[1]) : 20000;
+	int max = argc > 2 ? atoi(argv[2]) : sysconf(_SC_NPROCESSORS_ONLN);
+
+	synge_start();
+
+	/* expressions can use words which already exist */
+	synge_t tmp;
+	mpfr_init2(tmp, SYNGE_PRECISION);
+	synge_compute_string("f := 42", &tmp);
+
+	char **expressions = malloc(count * sizeof(char *));
+	synge_t *results = malloc(count * sizeof(synge_t)), *expected = malloc(count * sizeof(synge_t));
+	struct synge_err *errors = malloc(count * sizeof(struct synge_err)), *expected_errors = malloc(count * sizeof(struct synge_err));
+
+	int i, n = 0;
+	while(templates[n])
+		n++;
+
+	for(i = 0; i < count; i++) {
+		expressions[i] = malloc(128);
+		sprintf(expressions[i], templates[i % n], i, i, i);
+
+		mpfr_init2(results[i], SYNGE_PRECISION);
+		mpfr_init2(expected[i], SYNGE_PRECISION);
+	}
+
+	int threads, failed = 0;
+	double base = 0;
+
+	printf("%d expressions\n", count);
+	printf("threads\tseconds\texpr/s\tspeedup\n");
+
+	for(threads = 1; threads <= max; threads++) {
+		double start = now();
+		synge_compute_batch(expressions, count, threads == 1 ? expected : results, threads == 1 ? expected_errors : errors, threads);
+		double taken = now() - start;
+
+		if(threads == 1)
+			base = taken;
+
+		/* the results mustn't depend on how many threads were used */
+		for(i = 0; threads > 1 && i < count; i++) {
+			if(errors[i].code != expected_errors[i].code || !mpfr_equal_p(results[i], expected[i])) {
+				fprintf(stderr, "mismatch with %d threads: %s\n", threads, expressions[i]);
+				failed = 1;
+				break;
+			}
+		}
+
+		printf("%d\t%.3f\t%.0f\t%.2fx\n", threads, taken, count / taken, base / taken);
+	}
+
+	for(i = 0; i < count; i++) {
+		mpfr_clears(results[i], expected[i], NULL);
+		free(expressions[i]);
+	}
+
+	free(expressions);
+	free(results);
+	free(expected);
+	free(errors);
+	free(expected_errors);
+
+	mpfr_clear(tmp);
+	synge_end();
+	return failed;
+} /* main() */
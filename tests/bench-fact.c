@@ -0,0 +1,83 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SYNPOSIS:
+ *        ./tests/bench-fact [repeats]
+ *
+ * DESCRIPION:
+ *        Time fact(n) for n = 1e3 ... 1e6 (each repeated the given number of times, default 10),
+ *        checking that every result is the correctly rounded factorial.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <synge.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static unsigned long sizes[] = {
+	1000,
+	10000,
+	100000,
+	1000000,
+	0
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* now() */
+
+int main(int argc, char **argv) {
+	int repeats = argc > 1 ? atoi(argv[1]) : 10;
+
+	synge_start();
+
+	synge_t result, expected;
+	mpfr_inits2(SYNGE_PRECISION, result, expected, NULL);
+
+	int i, j, failed = 0;
+
+	printf("n\tseconds\tfact/s\n");
+
+	for(i = 0; sizes[i]; i++) {
+		char expression[64];
+		sprintf(expression, "fact(%lu)", sizes[i]);
+
+		double start = now();
+		for(j = 0; j < repeats; j++)
+			synge_compute_string(expression, &result);
+		double taken = now() - start;
+
+		/* mpfr's own factorial is correctly rounded */
+		mpfr_fac_ui(expected, sizes[i], MPFR_RNDN);
+		if(!mpfr_equal_p(result, expected)) {
+			fprintf(stderr, "mismatch: %s\n", expression);
+			failed = 1;
+		}
+
+		printf("%lu\t%.4f\t%.0f\n", sizes[i], taken / repeats, repeats / taken);
+	}
+
+	mpfr_clears(result, expected, NULL);
+	synge_end();
+	return failed;
+} /* main() */
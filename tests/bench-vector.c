@@ -0,0 +1,134 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SYNPOSIS:
+ *        ./tests/bench-vector [points]
+ *
+ * DESCRIPION:
+ *        Time each expression over the given number of points (default 20000) with both
+ *        synge_tabulate() on a single thread and a compiled synge_vector_run(), checking
+ *        that the compiled results are within double precision of the full precision ones.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <synge.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+static char *expressions[] = {
+	"sin(x)^2 + cos(x)^2",
+	"sqrt(x) * cbrt(x) / ln(x + 2)",
+	"3*x^3 - 2*x^2 + x - f",
+	"(x > 500) ? atan(x) : tanh(x / 1000)",
+	"g(x) + g(x / 2)",
+	"1 / (x - 100)",
+	NULL
+};
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+} /* now() */
+
+/* whether the compiled result is as close as a double can be to the full precision result */
+static int close_enough(double got, synge_t want, struct synge_err error) {
+	if(!synge_is_success_code(error.code))
+		return isnan(got);
+
+	double expected = mpfr_get_d(want, MPFR_RNDN);
+	return fabs(got - expected) <= 1e-9 * fmax(1, fabs(expected));
+} /* close_enough() */
+
+int main(int argc, char **argv) {
+	int count = argc > 1 ? atoi(argv[1]) : 20000;
+
+	synge_start();
+
+	/* expressions can use words which already exist */
+	synge_t tmp, from, to;
+	mpfr_inits2(SYNGE_PRECISION, tmp, from, to, NULL);
+	synge_compute_string("f := 42", &tmp);
+	synge_compute_string("g := x^2 / (1 + abs(x))", &tmp);
+
+	mpfr_set_si(from, 0, MPFR_RNDN);
+	mpfr_set_si(to, 1000, MPFR_RNDN);
+
+	synge_t *results = malloc(count * sizeof(synge_t));
+	struct synge_err *errors = malloc(count * sizeof(struct synge_err));
+	double *column = malloc(count * sizeof(double)), *output = malloc(count * sizeof(double));
+
+	/* the same points as the tabulation */
+	int i;
+	for(i = 0; i < count; i++) {
+		mpfr_init2(results[i], SYNGE_PRECISION);
+		column[i] = count > 1 ? 1000.0 * i / (count - 1) : 0;
+	}
+
+	char *variables[] = {"x"};
+	int n, failed = 0;
+
+	printf("%d points\n", count);
+	printf("scalar\tvector\tspeedup\texpression\n");
+
+	for(n = 0; expressions[n]; n++) {
+		double start = now();
+		synge_tabulate(expressions[n], "x", from, to, count, results, errors, 1);
+		double scalar = now() - start;
+
+		struct synge_err error;
+		struct synge_vector *vector = synge_vector_compile(expressions[n], variables, 1, &error);
+
+		if(!vector) {
+			fprintf(stderr, "couldn't compile %s: %s\n", expressions[n], synge_error_msg(error));
+			failed = 1;
+			continue;
+		}
+
+		start = now();
+		synge_vector_run(vector, &column, count, output);
+		double taken = now() - start;
+
+		for(i = 0; i < count; i++) {
+			if(!close_enough(output[i], results[i], errors[i])) {
+				fprintf(stderr, "mismatch at x = %g: %s\n", column[i], expressions[n]);
+				failed = 1;
+				break;
+			}
+		}
+
+		printf("%.3f\t%.4f\t%.0fx\t%s\n", scalar, taken, scalar / taken, expressions[n]);
+		synge_vector_free(vector);
+	}
+
+	for(i = 0; i < count; i++)
+		mpfr_clear(results[i]);
+
+	free(results);
+	free(errors);
+	free(column);
+	free(output);
+
+	mpfr_clears(tmp, from, to, NULL);
+	synge_end();
+	return failed;
+} /* main() */
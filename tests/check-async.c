@@ -0,0 +1,227 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SYNPOSIS:
+ *        ./tests/check-async
+ *
+ * DESCRIPION:
+ *        Check the asynchronous evaluation queue (tickets, a full queue, callbacks, collecting through the completion
+ *        descriptor and freeing the queue mid-evaluation), printing every check which fails.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <synge.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int failed = 0;
+
+#define check(cond) \
+	do { \
+		if(!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failed++; \
+		} \
+	} while(0)
+
+/* wait (up to five seconds) for the completion descriptor to become readable, then collect the next result */
+static struct synge_result *wait_collect(struct synge_async *async) {
+	struct synge_result *result;
+
+	while(!(result = synge_async_collect(async))) {
+		struct pollfd fd = {synge_async_fd(async), POLLIN, 0};
+		if(poll(&fd, 1, 5000) <= 0)
+			return NULL;
+	}
+
+	return result;
+} /* wait_collect() */
+
+/* results come back in the order they were submitted, each with its ticket */
+static void check_order(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	struct synge_async *async = synge_async_new(ctx, 8);
+
+	char *expressions[] = {"x = 4", "x * 2", "1 / 0", "x + 1"};
+	long values[] = {4, 8, 0, 5};
+	int i, tickets[4];
+
+	for(i = 0; i < 4; i++)
+		tickets[i] = synge_async_submit(async, expressions[i], NULL, NULL);
+
+	for(i = 0; i < 4; i++) {
+		check(tickets[i] == i);
+
+		struct synge_result *result = wait_collect(async);
+		check(result != NULL);
+		if(!result)
+			break;
+
+		check(result->ticket == tickets[i]);
+		if(i == 2)
+			check(result->error.code == DIVIDE_BY_ZERO && result->message && strstr(result->message, "Cannot divide by zero"));
+		else
+			check(result->error.code == SUCCESS && !result->message && mpfr_cmp_si(result->value, values[i]) == 0);
+
+		synge_result_free(result);
+	}
+
+	check(synge_async_collect(async) == NULL);
+
+	synge_async_free(async);
+	synge_ctx_free(ctx);
+} /* check_order() */
+
+/* the descriptor is only readable while there are results waiting */
+static void check_fd(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	struct synge_async *async = synge_async_new(ctx, 1);
+
+	struct pollfd fd = {synge_async_fd(async), POLLIN, 0};
+	check(fd.fd >= 0);
+	check(poll(&fd, 1, 0) == 0);
+
+	check(synge_async_submit(async, "2 + 2", NULL, NULL) == 0);
+	check(poll(&fd, 1, 5000) == 1 && (fd.revents & POLLIN));
+
+	struct synge_result *result = synge_async_collect(async);
+	check(result != NULL && mpfr_cmp_si(result->value, 4) == 0);
+	if(result)
+		synge_result_free(result);
+
+	fd.revents = 0;
+	check(poll(&fd, 1, 0) == 0);
+
+	synge_async_free(async);
+	synge_ctx_free(ctx);
+} /* check_fd() */
+
+struct callback_log {
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+
+	int count;
+	int tickets[4];
+	long values[4];
+};
+
+static void log_result(struct synge_result *result, void *data) {
+	struct callback_log *log = data;
+
+	pthread_mutex_lock(&log->lock);
+	log->tickets[log->count] = result->ticket;
+	log->values[log->count] = mpfr_get_si(result->value, SYNGE_ROUND);
+	log->count++;
+	pthread_cond_signal(&log->done);
+	pthread_mutex_unlock(&log->lock);
+} /* log_result() */
+
+/* results with a callback are handed to it (and never collected), and the rest wait to be collected */
+static void check_callbacks(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	struct synge_async *async = synge_async_new(ctx, 4);
+
+	struct callback_log log = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, {0}, {0}};
+
+	check(synge_async_submit(async, "10", log_result, &log) == 0);
+	check(synge_async_submit(async, "20", NULL, NULL) == 1);
+	check(synge_async_submit(async, "30", log_result, &log) == 2);
+
+	pthread_mutex_lock(&log.lock);
+	while(log.count < 2)
+		pthread_cond_wait(&log.done, &log.lock);
+	pthread_mutex_unlock(&log.lock);
+
+	check(log.tickets[0] == 0 && log.values[0] == 10);
+	check(log.tickets[1] == 2 && log.values[1] == 30);
+
+	struct synge_result *result = wait_collect(async);
+	check(result != NULL && result->ticket == 1 && mpfr_cmp_si(result->value, 20) == 0);
+	if(result)
+		synge_result_free(result);
+
+	check(synge_async_collect(async) == NULL);
+
+	synge_async_free(async);
+	synge_ctx_free(ctx);
+} /* check_callbacks() */
+
+/* a full queue turns submissions away, and freeing it stops an evaluation which would otherwise never end */
+static void check_full(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	synge_t result;
+	mpfr_init2(result, SYNGE_PRECISION);
+
+	/* a tail call loop, which doesn't run into the depth limit */
+	synge_ctx_compute_string(ctx, "n = 0", &result);
+	synge_ctx_compute_string(ctx, "f := n ? f : 0", &result);
+	synge_ctx_compute_string(ctx, "n = 1", &result);
+
+	struct synge_async *async = synge_async_new(ctx, 2);
+
+	check(synge_async_submit(async, "f", NULL, NULL) == 0);
+	check(synge_async_submit(async, "1", NULL, NULL) == 1);
+	check(synge_async_submit(async, "2", NULL, NULL) == -1);
+
+	/* give the loop time to start */
+	struct timespec wait = {0, 50000000};
+	nanosleep(&wait, NULL);
+
+	synge_async_free(async);
+
+	/* the context is left as it was, without a token of its own */
+	check(synge_ctx_compute_string(ctx, "n = 0", &result).code == SUCCESS);
+	check(synge_ctx_compute_string(ctx, "f", &result).code == SUCCESS);
+
+	/* a token the context already had is left as it was, too */
+	struct synge_cancel *token = synge_cancel_new();
+	synge_ctx_set_cancel(ctx, token);
+
+	check(synge_ctx_compute_string(ctx, "n = 1", &result).code == SUCCESS);
+	async = synge_async_new(ctx, 1);
+	check(synge_async_submit(async, "f", NULL, NULL) == 0);
+
+	nanosleep(&wait, NULL);
+	synge_async_free(async);
+
+	check(!synge_cancel_is_set(token));
+	check(synge_ctx_compute_string(ctx, "n = 0", &result).code == SUCCESS);
+
+	synge_ctx_free(ctx);
+	synge_cancel_free(token);
+	mpfr_clear(result);
+} /* check_full() */
+
+int main(void) {
+	check_order();
+	check_fd();
+	check_callbacks();
+	check_full();
+
+	if(failed)
+		fprintf(stderr, "%d checks failed\n", failed);
+
+	mpfr_free_cache();
+	return failed != 0;
+} /* main() */
@@ -0,0 +1,405 @@
+/* Synge: A shunting-yard calculation "engine"
+ * Copyright (C) 2013, 2016 Aleksa Sarai
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * SYNPOSIS:
+ *        ./tests/check-ctx
+ *
+ * DESCRIPION:
+ *        Check the context API directly (things the expression test suite can't reach through synge-eval),
+ *        printing every check which fails.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <synge.h>
+#include <ohmic.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int failed = 0;
+
+#define check(cond) \
+	do { \
+		if(!(cond)) { \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			failed++; \
+		} \
+	} while(0)
+
+/* evaluates an expression in a context, returning its error code and checking its result (if it succeeded) */
+static int compute(struct synge_ctx *ctx, char *expression, long expected) {
+	synge_t result;
+	mpfr_init2(result, SYNGE_PRECISION);
+
+	struct synge_err error = synge_ctx_compute_string(ctx, expression, &result);
+	if(error.code == SUCCESS && mpfr_cmp_si(result, expected)) {
+		fprintf(stderr, "%s gave %ld, expected %ld\n", expression, mpfr_get_si(result, SYNGE_ROUND), expected);
+		failed++;
+	}
+
+	mpfr_clear(result);
+	return error.code;
+} /* compute() */
+
+/* words, settings and tracebacks belong to the context which made them */
+static void check_isolation(void) {
+	struct synge_ctx *a = synge_ctx_new(), *b = synge_ctx_new();
+
+	check(compute(a, "x = 3", 3) == SUCCESS);
+	check(compute(a, "f := x * 2", 6) == SUCCESS);
+	check(compute(b, "x", 0) == UNKNOWN_TOKEN);
+	check(compute(b, "f", 0) == UNKNOWN_TOKEN);
+
+	/* the same name can mean different things in each */
+	check(compute(b, "x = 10", 10) == SUCCESS);
+	check(compute(a, "f", 6) == SUCCESS);
+	check(compute(b, "x", 10) == SUCCESS);
+
+	struct synge_settings settings = synge_ctx_get_settings(a);
+	settings.mode = radians;
+	synge_ctx_set_settings(a, settings);
+
+	check(compute(a, "cos(pi)", -1) == SUCCESS);
+	check(synge_ctx_get_settings(b).mode == degrees);
+	check(compute(b, "cos(180)", -1) == SUCCESS);
+
+	/* freeing one doesn't touch the other */
+	synge_ctx_free(a);
+	check(compute(b, "x + 1", 11) == SUCCESS);
+	synge_ctx_free(b);
+} /* check_isolation() */
+
+/* a duplicate starts with a copy of the words, and a base layer is shared without ever being changed */
+static void check_dup(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	check(compute(ctx, "x = 5", 5) == SUCCESS);
+	check(compute(ctx, "g := x + 1", 6) == SUCCESS);
+
+	struct synge_ctx *dup = synge_ctx_dup(ctx);
+	check(compute(dup, "g", 6) == SUCCESS);
+
+	/* the copies go their separate ways */
+	check(compute(dup, "x = 7", 7) == SUCCESS);
+	check(compute(ctx, "g", 6) == SUCCESS);
+	check(compute(ctx, "::x", 5) == SUCCESS);
+	check(compute(dup, "g", 8) == SUCCESS);
+
+	struct synge_base *base = synge_base_new(dup);
+	struct synge_ctx *a = synge_ctx_new(), *b = synge_ctx_new();
+	synge_ctx_set_base(a, base);
+	synge_ctx_set_base(b, base);
+
+	check(compute(a, "g", 8) == SUCCESS);
+	check(compute(b, "g", 8) == SUCCESS);
+
+	/* a context's own words shadow the base's, without changing them for anyone else */
+	check(compute(a, "x = 1", 1) == SUCCESS);
+	check(compute(a, "g", 2) == SUCCESS);
+	check(compute(b, "g", 8) == SUCCESS);
+	check(compute(b, "::g", 8) == SUCCESS);
+	check(compute(b, "g", 0) == UNKNOWN_TOKEN);
+	check(compute(a, "g", 2) == SUCCESS);
+
+	/* and a duplicate of a context keeps its base (and what it hides of it) */
+	struct synge_ctx *c = synge_ctx_dup(b);
+	check(compute(c, "g", 0) == UNKNOWN_TOKEN);
+	check(compute(c, "x", 7) == SUCCESS);
+	check(compute(c, "g := x * 2", 14) == SUCCESS);
+	check(compute(b, "g", 0) == UNKNOWN_TOKEN);
+	check(compute(a, "g", 2) == SUCCESS);
+
+	synge_ctx_free(a);
+	synge_ctx_free(b);
+	synge_ctx_free(c);
+	synge_base_free(base);
+
+	synge_ctx_free(dup);
+	synge_ctx_free(ctx);
+} /* check_dup() */
+
+/* formatting an error into a caller's buffer works like snprintf(), and agrees with the context's own message */
+static void check_format_error(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+
+	struct synge_settings settings = synge_ctx_get_settings(ctx);
+	settings.error = traceback;
+	synge_ctx_set_settings(ctx, settings);
+
+	synge_t result;
+	mpfr_init2(result, SYNGE_PRECISION);
+
+	synge_ctx_compute_string(ctx, "f := 1 + 1/0", &result);
+	struct synge_err error = synge_ctx_compute_string(ctx, "2 * f", &result);
+	check(error.code == DIVIDE_BY_ZERO);
+
+	char *msg = synge_ctx_error_msg(ctx, error);
+	int length = strlen(msg);
+	check(strstr(msg, "Function f") != NULL);
+
+	char buf[512], small[8];
+	check(synge_ctx_format_error(ctx, error, buf, sizeof(buf)) == length);
+	check(!strcmp(buf, msg));
+
+	/* a short buffer gets as much as fits, and is still terminated */
+	memset(small, 'x', sizeof(small));
+	check(synge_ctx_format_error(ctx, error, small, sizeof(small)) == length);
+	check(!strncmp(small, msg, sizeof(small) - 1) && small[sizeof(small) - 1] == '\0');
+
+	/* and an empty one isn't touched at all */
+	small[0] = 'x';
+	check(synge_ctx_format_error(ctx, error, small, 0) == length);
+	check(small[0] == 'x');
+
+	mpfr_clear(result);
+	synge_ctx_free(ctx);
+} /* check_format_error() */
+
+static void *cancel_later(void *token) {
+	struct timespec wait = {0, 50000000};
+	nanosleep(&wait, NULL);
+
+	synge_cancel_set(token);
+	return NULL;
+} /* cancel_later() */
+
+/* a token set on another thread stops an evaluation which would otherwise never end */
+static void check_cancel(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	struct synge_cancel *token = synge_cancel_new();
+	synge_ctx_set_cancel(ctx, token);
+
+	/* a tail call loop, which doesn't run into the depth limit */
+	check(compute(ctx, "n = 0", 0) == SUCCESS);
+	check(compute(ctx, "f := n ? f : 0", 0) == SUCCESS);
+	check(compute(ctx, "n = 1", 1) == SUCCESS);
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, cancel_later, token);
+	check(compute(ctx, "f", 0) == CANCELLED);
+	pthread_join(thread, NULL);
+
+	/* it stays set, stopping anything else watching it */
+	check(synge_cancel_is_set(token));
+	check(compute(ctx, "1 + 1", 2) == CANCELLED);
+
+	struct synge_ctx *dup = synge_ctx_dup(ctx);
+	synge_ctx_set_cancel(dup, token);
+	check(compute(dup, "n", 1) == CANCELLED);
+
+	synge_cancel_reset(token);
+	check(compute(dup, "n", 1) == SUCCESS);
+	check(compute(ctx, "n = 0", 0) == SUCCESS);
+	check(compute(ctx, "f", 0) == SUCCESS);
+
+	synge_ctx_free(dup);
+	synge_ctx_free(ctx);
+	synge_cancel_free(token);
+} /* check_cancel() */
+
+/* a budget applies to the context which is given it, including one just duplicated from another */
+static void check_budget(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	check(compute(ctx, "n = 0", 0) == SUCCESS);
+	check(compute(ctx, "g := n ? n-- + g : 0", 0) == SUCCESS);
+
+	struct synge_ctx *dup = synge_ctx_dup(ctx);
+	check(compute(dup, "n = 100", 100) == SUCCESS);
+
+	synge_t result;
+	mpfr_init2(result, SYNGE_PRECISION);
+
+	struct synge_budget limit = {0, 4096, 0}, used;
+	struct synge_err error = synge_ctx_compute_budget(dup, "g", &result, &limit, &used);
+	check(error.code == MEMORY_LIMIT);
+	check(used.memory > limit.memory && used.calls > 0 && used.calls < 100);
+
+	/* the budget only lasts for the one evaluation */
+	check(compute(dup, "n = 100", 100) == SUCCESS);
+	error = synge_ctx_compute_budget(dup, "g", &result, NULL, &used);
+	check(error.code == SUCCESS && mpfr_cmp_si(result, 5050) == 0);
+	check(used.memory > limit.memory && used.calls == 101);
+
+	/* and the original can run the same thing under its own limits */
+	limit = (struct synge_budget) {0, 0, 10};
+	check(compute(ctx, "n = 100", 100) == SUCCESS);
+	error = synge_ctx_compute_budget(ctx, "g", &result, &limit, &used);
+	check(error.code == CALL_LIMIT && used.calls == limit.calls);
+
+	mpfr_clear(result);
+	synge_ctx_free(dup);
+	synge_ctx_free(ctx);
+} /* check_budget() */
+
+/* snapshots are taken and released like references, and stay as they were however far the context moves on */
+static void check_snapshot(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	check(synge_ctx_get_snapshot(ctx) == NULL);
+
+	check(compute(ctx, "y = 2", 2) == SUCCESS);
+	struct synge_base *base = synge_base_new(ctx);
+	synge_ctx_free(ctx);
+
+	ctx = synge_ctx_new();
+	synge_ctx_set_base(ctx, base);
+	synge_ctx_publish(ctx, true);
+
+	check(compute(ctx, "x = 1", 1) == SUCCESS);
+	struct synge_snapshot *first = synge_ctx_get_snapshot(ctx);
+	check(first != NULL);
+
+	/* only the context's own words are copied, but the base's can still be looked up */
+	check(synge_snapshot_get_variable(first, "x") && mpfr_cmp_si(*synge_snapshot_get_variable(first, "x"), 1) == 0);
+	check(synge_snapshot_get_variable(first, "y") && mpfr_cmp_si(*synge_snapshot_get_variable(first, "y"), 2) == 0);
+	check(ohm_search(synge_snapshot_variable_list(first), "y", 2) == NULL);
+
+	/* taking it again without any changes gives the same snapshot */
+	struct synge_snapshot *again = synge_ctx_get_snapshot(ctx);
+	check(again == first);
+	synge_snapshot_release(again);
+
+	check(compute(ctx, "x = 5", 5) == SUCCESS);
+	check(compute(ctx, "f := x + y", 7) == SUCCESS);
+	check(compute(ctx, "::y", 2) == SUCCESS);
+
+	struct synge_snapshot *second = synge_ctx_get_snapshot(ctx);
+	check(second != first && synge_snapshot_version(second) > synge_snapshot_version(first));
+	check(mpfr_cmp_si(*synge_snapshot_get_variable(second, "x"), 5) == 0);
+	check(synge_snapshot_get_expression(second, "f") && !strcmp(synge_snapshot_get_expression(second, "f"), "x + y"));
+	check(synge_snapshot_get_variable(second, "y") == NULL);
+
+	/* the older snapshot is still as it was, even once the context has gone */
+	synge_ctx_free(ctx);
+	check(mpfr_cmp_si(*synge_snapshot_get_variable(first, "x"), 1) == 0);
+	check(synge_snapshot_get_expression(first, "f") == NULL);
+	check(synge_snapshot_get_variable(first, "y") != NULL);
+
+	synge_snapshot_release(first);
+	synge_snapshot_release(second);
+	synge_base_free(base);
+} /* check_snapshot() */
+
+struct snapshot_reader {
+	struct synge_ctx *ctx;
+	int done;
+	int bad;
+};
+
+/* keep taking snapshots, checking that each one is no older than the last */
+static void *read_snapshots(void *arg) {
+	struct snapshot_reader *reader = arg;
+	unsigned long version = 0;
+	long x = 0;
+
+	while(!__atomic_load_n(&reader->done, __ATOMIC_SEQ_CST)) {
+		struct synge_snapshot *snapshot = synge_ctx_get_snapshot(reader->ctx);
+		if(!snapshot)
+			continue;
+
+		synge_t *value = synge_snapshot_get_variable(snapshot, "x");
+		if(!value || synge_snapshot_version(snapshot) < version || mpfr_get_si(*value, SYNGE_ROUND) < x)
+			reader->bad++;
+		else {
+			version = synge_snapshot_version(snapshot);
+			x = mpfr_get_si(*value, SYNGE_ROUND);
+		}
+
+		synge_snapshot_release(snapshot);
+	}
+
+	return NULL;
+} /* read_snapshots() */
+
+/* snapshots can be taken on another thread while the context keeps evaluating */
+static void check_snapshot_readers(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	struct snapshot_reader reader = {ctx, 0, 0};
+
+	check(compute(ctx, "x = 0", 0) == SUCCESS);
+	synge_ctx_publish(ctx, true);
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, read_snapshots, &reader);
+
+	int i;
+	for(i = 1; i <= 2000; i++)
+		compute(ctx, "x = x + 1", i);
+
+	__atomic_store_n(&reader.done, 1, __ATOMIC_SEQ_CST);
+	pthread_join(thread, NULL);
+	check(reader.bad == 0);
+
+	struct synge_snapshot *snapshot = synge_ctx_get_snapshot(ctx);
+	check(mpfr_cmp_si(*synge_snapshot_get_variable(snapshot, "x"), 2000) == 0);
+	synge_snapshot_release(snapshot);
+
+	synge_ctx_free(ctx);
+} /* check_snapshot_readers() */
+
+/* an interval evaluation sets '_' the same way as any other evaluation */
+static void check_interval_answer(void) {
+	struct synge_ctx *ctx = synge_ctx_new();
+	synge_t result;
+	mpfr_init2(result, SYNGE_PRECISION);
+
+	check(compute(ctx, "2", 2) == SUCCESS);
+	check(synge_ctx_compute_interval(ctx, "_ + 1", &result).code == SUCCESS && mpfr_cmp_si(result, 3) == 0);
+
+	/* an expression which refers to '_' doesn't become '_' */
+	check(compute(ctx, "_", 2) == SUCCESS);
+	check(compute(ctx, "_ * 5", 10) == SUCCESS);
+
+	check(synge_ctx_compute_interval(ctx, "  3 * 4  ", &result).code == SUCCESS && mpfr_cmp_si(result, 12) == 0);
+	check(!strcmp(ohm_search(synge_ctx_get_expression_list(ctx), "_", 2), "3 * 4"));
+	check(compute(ctx, "_ + 1", 13) == SUCCESS);
+
+	/* and evaluating the same expression again doesn't publish a new snapshot */
+	synge_ctx_publish(ctx, true);
+	synge_ctx_compute_interval(ctx, "3 * 4", &result);
+
+	struct synge_snapshot *first = synge_ctx_get_snapshot(ctx);
+	synge_ctx_compute_interval(ctx, "3 * 4", &result);
+	struct synge_snapshot *second = synge_ctx_get_snapshot(ctx);
+	check(first == second);
+
+	synge_snapshot_release(first);
+	synge_snapshot_release(second);
+
+	mpfr_clear(result);
+	synge_ctx_free(ctx);
+} /* check_interval_answer() */
+
+int main(void) {
+	check_isolation();
+	check_dup();
+	check_format_error();
+	check_cancel();
+	check_budget();
+	check_snapshot();
+	check_snapshot_readers();
+	check_interval_answer();
+
+	if(failed)
+		fprintf(stderr, "%d checks failed\n", failed);
+
+	mpfr_free_cache();
+	return failed != 0;
+} /* main() */
@@ -52,6 +52,10 @@ errors = {
 		"empty"		: "Expression was empty",
 		"undef"		: "Result is undefined",
 		"delved"	: "Delved too deep",
+		"timeout"	: "Evaluation took too long",
+		"steps"		: "Evaluation took too many steps",
+		"memory"	: "Evaluation used too much memory",
+		"calls"		: "Evaluation made too many function calls",
 		"unknown"	: "An unknown error has occured",
 }
 
@@ -61,6 +65,9 @@ def error_get(key, position = 0):
 	else:
 		return errors[key]
 
+def traceback_get(levels, kind, key, position = 0):
+	return ["Synge Traceback (most recent call last):", "  Module <main>"] + ["  " + level for level in levels] + ["%s: %s" % (kind, error_get(key, position))]
+
 # List of case tuples
 
 CASES = [
@@ -110,6 +117,9 @@ CASES = [
 	(["8#-2"],						["-10"],			0,	0,		"Bitwise XOR		"),
 	(["15.1#2"],					["13"],				0,	0,		"Bitwise XOR		"),
 
+	(["((1<<2000)|1)&1", "(2^1100|3)&7"],	["1", "3"],			0,	0,		"Large Bitwise		"),
+	(["((1<<20000)#(1<<19999))>>19999"],	["3"],				0,	0,		"Large Bitwise		"),
+
 	(["~5"],						["-6"],				0,	0,		"Bitwise NOT		"),
 	(["~-2"],						["1"],				0,	0,		"Bitwise NOT		"),
 	(["~15.1"],						["-16"],			0,	0,		"Bitwise NOT		"),
@@ -122,6 +132,9 @@ CASES = [
 	(["~(-3)"],						["2"],				0,	0,		"Bitwise NOT Sign	"),
 	(["~(3)"],						["-4"],				0,	0,		"Bitwise NOT Sign	"),
 
+	(["9223372036854775807+1", "-9223372036854775807-2"],	["9223372036854775808", "-9223372036854775809"],	0,	0,	"Integer Overflow	"),
+	(["3037000500*3037000500"],		["9223372037000250000"],	0,	0,		"Integer Overflow	"),
+
 	(["!2"],						["0"],				0,	0,		"Unary NOT		"),
 	(["!34"],						["0"],				0,	0,		"Unary NOT		"),
 	(["!0"],						["1"],				0,	0,		"Unary NOT		"),
@@ -254,12 +267,37 @@ CASES = [
 	(["ln(e^2)"],					["2"],				0,	0,		"Assorted Functions	"),
 	(["fact(3)"],					["6"],				0,	0,		"Assorted Functions	"),
 	(["fact(4)"],					["24"],				0,	0,		"Assorted Functions	"),
+	(["fact(-5.5)", "fact(1e6)/fact(1e6-1)"],	["-120", "1000000"],	0,	0,		"Assorted Functions	"),
+	(["fact(4.9)", "fact(3000.7)/fact(2999)"],	["24", "3000"],		0,	0,		"Assorted Functions	"),
+	(["x=10.5", "sum(x)", "x"],		["10.5", "55", "10.5"],		0,	0,		"Assorted Functions	"),
+	(["hypot(3, 4)", "pow(2, 10)", "fma(2, 3, -4)", "log(3, 81)"],	["5", "1024", "2", "4"],	0,	0,	"Multiple Arguments	"),
+	(["min(5, 3, 9, -1, 7)", "max(1+2, 2^3)", "max(4)"],	["-1", "8", "4"],	0,	0,		"Multiple Arguments	"),
+	(["sum(4)", "total(4)", "total(1, 2, 3, 4)", "total(1e300, 1, -1e300)"],	["10", "4", "10", "1"],	0,	0,	"Aggregate Functions	"),
+	(["sum(4, 0)"],					[error_get("funcvals", 1)],	0,	0,		"Aggregate Functions	"),
+	(["mean(1, 2, 3, 4)", "prod(1, 2, 3, 4, 5)", "stddev(2, 4, 4, 4, 5, 5, 7, 9)"],	["2.5", "120", "2"],	0,	0,	"Aggregate Functions	"),
+	(["dot(1, 2, 3, 4, 5, 6)", "dot(1, 2, 3)"],	["32", error_get("undef")],	0,	0,		"Aggregate Functions	"),
 
 	(["randi(100)"],				["52"],				0,	0,		"'Random' Function	"),
 	(["randi(13)"],					["7"],				0,	0,		"'Random' Function	"),
 	(["randi(14.7)"],				["7"],				0,	0,		"'Random' Function	"),
 	(["randi(42)"],					["22"],				0,	0,		"'Random' Function	"),
 	(["randi(52)"],					["27"],				0,	0,		"'Random' Function	"),
+	(["-r", "7:0", "randi(1000)", "randi(1000)"],	["655", "671"],			0,	0,		"Random Stream		"),
+	(["-r", "7:1", "randi(1000)", "randi(1000)"],	["745", "4"],			0,	0,		"Random Stream		"),
+
+	(["-T", "x:0:1:5", "x*4"],		["0", "1", "2", "3", "4"],	0,	0,		"Tabulation		"),
+	(["-T", "x:0:2:3", "1/x"],		[error_get("zerodiv", 2), "1", "0.5"],	0,	0,		"Tabulation		"),
+	(["-T", "x:1:3:3", "x = x*2"],	["2", "4", "6"],			0,	0,		"Tabulation		"),
+
+	(["-i", "sqrt(2)^2", "1/3", "cos(60)"],	["2", "0.3333333333333333333333333333333333333333333333333333333333333333", "0.5"],	0,	0,		"Interval		"),
+	(["-i", "x = 4", "x*3", "_ + 1", "1/(x-4)"],	["4", "12", "13", error_get("zerodiv", 2)],	0,	0,		"Interval		"),
+
+	(["-x", "1e400+0.1-1e400", "-(10^400+1) + 10^400", "1/3 + 1/6", "0.1^3 == 0.001", "sqrt(0.25) * 0.1"],
+	 ["0.1", "-1", "0.5", "1", "0.05"],											0,	0,		"Exact Arithmetic	"),
+	(["-x", "1.5 / (0.5 - 0.5)", "0^(-1)"],	[error_get("zerodiv", 5), "inf"],	0,	0,		"Exact Arithmetic	"),
+	(["-x", "1e-70 > 0", "1e-300 == 0", "1e-70 ? 1 : 2", "!1e-70", "!(0.1 + 0.2 - 0.3)", "(0.1 + 0.2 - 0.3) ? 1 : 2"],
+	 ["1", "0", "1", "0", "1", "2"],												0,	0,		"Exact Truthiness	"),
+	(["1e-70 > 0", "1e-300 == 0", "1e-70 ? 1 : 2", "!1e-70"],	["0", "1", "2", "1"],	0,	0,		"Exact Truthiness	"),
 
 	(["log10(100)/2"],				["1"],				0,	0,		"Function Division	"),
 	(["ln(100)/ln(10)"],			["2"],				0,	0,		"Function Division	"),
@@ -286,6 +324,7 @@ CASES = [
 	(["tan(45)+cos(60)+sin(30)"],	["2"],				deg,	0,		"Degrees Trigonometry	"),
 	(["atan(1)+acos(0.5)+asin(0)"],	["105"],			deg,	0,		"Degrees Trigonometry	"),
 	(["atan(sin(30)/cos(30))"],		["30"],				deg,	0,		"Degrees Trigonometry	"),
+	(["atan2(1, -1)"],				["135"],			deg,	0,		"Degrees Trigonometry	"),
 
 	(["tan(45)+cos(60)+sin(30)"],
 	["-0.3206694139641565326987689858924589712956105145341298199928108166"],	rad,	0,		"Radian Trigonometry	"),
@@ -416,6 +455,26 @@ CASES = [
 	(["life", "8-life", "8+life", "-life+8", "+life+8"],
 	 ["42",   "-34",    "50",     "-34",     "50"],				0,	0,		"Constant Signing	"),
 
+	(["n=5000", "f:=n?(n--+f):0", "n"],
+	 ["5000",   "12502500",        "0"],						0,	0,		"Deep Recursion		"),
+
+	(["n=20000", "acc=0", "f:=n?((acc+=n--)?f:f):acc", "n", "f"],
+	 ["20000",   "0",     "200010000",                  "0", "200010000"],	0,	0,		"Tail Recursion		"),
+	(["-d", "1000", "n=5000", "acc=0", "f:=n?((acc+=n--)?f:f):acc", "f", "n=5000", "g:=n?(n--+g):0", "g", "n"],
+	 ["5000", "0", "12502500", "12502500", "5000", error_get("unknown", 2), error_get("delved", 1), "5000"],	0,	0,		"Tail Recursion		"),
+
+	(["-E", "traceback", "a:=b", "b:=c+1", "c:=1/0", "1+a"],
+	 traceback_get(["Function a, at 2"], "OtherError", "unknown", 2) +
+	 traceback_get(["Function b, at 2"], "OtherError", "unknown", 2) +
+	 traceback_get(["Function c, at 2"], "OtherError", "unknown", 2) +
+	 traceback_get(["Function a, at 3", "Function b, at 1", "Function c, at 1"], "MathError", "zerodiv", 2),	0,	0,	"Tail Call Traceback	"),
+	(["-E", "traceback", "n=2", "f:=n?(n--?f:f):1/0", "n=2", "f"],
+	 ["2"] + traceback_get(["Function f, at 2", "... 6 tail calls elided", "<else> condition, at 12"], "OtherError", "unknown", 2) +
+	 ["2"] + traceback_get(["Function f, at 1", "... 6 tail calls elided", "<else> condition, at 12"], "MathError", "zerodiv", 2),	0,	0,	"Tail Call Traceback	"),
+
+	(["a=1", "g:=(a=5)+1/0",         "a", "g",                    "a"],
+	 ["1",   error_get("unknown", 2), "1", error_get("zerodiv", 1), "1"],	0,	0,		"Error Rollback		"),
+
 	(["a=4", "++a/2"], ["4", "2.5"],				    	0,	0,		"Regression Test		"),
 
 	# expected errors
@@ -464,6 +523,7 @@ CASES = [
 
 	(["2+1-"],						[error_get("opvals", 4)],	0,	0,		"Token Number Error	"),
 	(["abs()"],						[error_get("funcvals", 1)],	0,	0,		"Token Number Error	"),
+	(["atan2(1)", "max(1,,2)"],		[error_get("funcvals", 1), error_get("funcvals", 7)],	0,	0,	"Token Number Error	"),
 
 	(["3?3"],						[error_get("elseop", 2)],	0,	0,			"Conditional Error	"),
 	(["3?:3"],						[error_get("ifblock", 2)],	0,	0,			"Conditional Error	"),
@@ -477,6 +537,20 @@ CASES = [
 
 	(["a:=b", "b:=c", "c:=a", "1+a"], [error_get("unknown", 2), error_get("unknown", 2), error_get("unknown", 2), error_get("delved", 3)],
 																0,	0,		"Recursion Error		"),
+
+	(["-b", "0:0:1000", "n=0", "f:=n?f:0", "n=1", "f"],	["0", "0", "1", error_get("calls", 1)],	0,	0,		"Recursion Error		"),
+
+	(["-t", "50", "x=3", "n=1e9", "x=(f:=n?(n--?f:f):0)", "x", "n"],
+	 ["3", "1000000000", error_get("timeout", 5), "3", "1000000000"],				0,	0,		"Timeout Error		"),
+	(["-t", "50", "n=1e9", "f:=n?(n--?f:f):0", "n", "f"],
+	 ["1000000000", error_get("timeout", 2), "1000000000", error_get("token", 1)],	0,	0,		"Timeout Error		"),
+
+	(["-b", "10:0:0", "1+2+3+4+5", "x=1", "x=(x=5)+1+1+1+1+1+1", "x"],
+	 ["15", "1", error_get("steps", 15), "1"],										0,	0,		"Step Budget Error	"),
+	(["-b", "0:0:100", "n=5000", "f:=n?(n--+f):0", "n", "f"],
+	 ["5000", error_get("calls", 2), "5000", error_get("token", 1)],				0,	0,		"Call Budget Error	"),
+	(["-b", "0:4000:0", "1+1", "1+2+3+4+5+6+7+8+9+10+11+12+13+14+15+16+17+18+19+20"],
+	 ["2", error_get("memory", 1)],													0,	0,		"Memory Budget Error	"),
 ]
 
 def test_calc(program, test, expected, mode, change, description):